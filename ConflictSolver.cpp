@@ -0,0 +1,415 @@
+#include "stdafx.h"
+#include "ConflictSolver.h"
+#include "GridMoves.h"
+#include <algorithm>
+#include <queue>
+#include <tuple>
+
+ConflictSolver::ConflictSolver(Map& mref) {
+	mapref = &mref;
+}
+
+bool ConflictSolver::outOfBudget() {
+	return int(tree.size()) >= maxTreeNodes || clock.getElapsedTime() >= timeLimit;
+}
+
+void ConflictSolver::measureSteps(int agent) {
+	//Steps from every tile to the goal, the low level search's estimate and the test for unreachable goals
+	std::vector<int>& steps = stepsToGoal[agent];
+	steps.assign(mapref->tileCount, -1);
+	std::vector<int> frontier = { goals[agent] };
+	steps[goals[agent]] = 0;
+	int around[8];
+	float costs[8];
+	for (size_t i = 0; i < frontier.size(); ++i) {
+		int tile = frontier[i];
+		int count = gridNeighbors(*mapref, tile, around, costs);
+		for (int n = 0; n < count; ++n) {
+			if (steps[around[n]] < 0) {
+				steps[around[n]] = steps[tile] + 1;
+				frontier.push_back(around[n]);
+			}
+		}
+	}
+}
+
+bool ConflictSolver::solve(const std::vector<int>& startTiles, const std::vector<int>& goalTiles, std::vector<std::vector<int>>& paths) {
+	clock.restart();
+	starts = startTiles;
+	goals = goalTiles;
+	int agentCount = starts.size();
+	solved = false;
+	optimal = false;
+	treeNodes = 0;
+	expansions = 0;
+	sumOfCosts = 0;
+	tree.clear();
+	paths.assign(agentCount, path());
+
+	stepsToGoal.resize(agentCount);
+	for (int a = 0; a < agentCount; ++a) {
+		measureSteps(a);
+		if (stepsToGoal[a][starts[a]] < 0) {
+			runtime = clock.getElapsedTime();
+			return false;
+		}
+	}
+
+	//The root plans every agent alone, only preferring to stay out of the ways already planned
+	treeNode root;
+	root.parent = -1;
+	root.added = constraint{ -1, 0, -1, -1 };
+	root.paths.resize(agentCount);
+	for (int a = 0; a < agentCount; ++a) {
+		path p;
+		if (!planAgent(a, constraintTable(), &root.paths, p)) {
+			runtime = clock.getElapsedTime();
+			return false;
+		}
+		root.paths[a] = std::make_shared<const path>(std::move(p));
+	}
+	std::vector<conflict> found;
+	findConflicts(root.paths, found);
+	root.cost = countCost(root.paths);
+	root.conflicts = found.size();
+	tree.push_back(root);
+
+	//Cheapest node first, and the one with fewer collisions left among equals
+	typedef std::tuple<int, int, int> openEntry;
+	std::priority_queue<openEntry, std::vector<openEntry>, std::greater<openEntry>> open;
+	open.push(openEntry(root.cost, root.conflicts, 0));
+	while (!open.empty() && !outOfBudget()) {
+		int node = std::get<2>(open.top());
+		open.pop();
+		findConflicts(tree[node].paths, found);
+		if (found.empty()) {
+			for (int a = 0; a < agentCount; ++a) {
+				paths[a] = *tree[node].paths[a];
+			}
+			solved = true;
+			optimal = true;
+			sumOfCosts = tree[node].cost;
+			treeNodes = tree.size();
+			runtime = clock.getElapsedTime();
+			return true;
+		}
+		const conflict c = found[pickConflict(node, found)];
+
+		//One child keeps a away from the collision and the other keeps b away
+		int children[2] = { -1, -1 };
+		constraint rules[2];
+		if (c.swap) {
+			rules[0] = constraint{ c.a, c.step, c.tileA, c.tileB };
+			rules[1] = constraint{ c.b, c.step, c.tileB, c.tileA };
+		}
+		else {
+			rules[0] = constraint{ c.a, c.step, -1, c.tileA };
+			rules[1] = constraint{ c.b, c.step, -1, c.tileA };
+		}
+		bool bypassed = false;
+		for (int side = 0; side < 2 && !bypassed; ++side) {
+			treeNode child;
+			child.parent = node;
+			child.added = rules[side];
+			child.paths = tree[node].paths;
+			tree.push_back(child);
+			int index = tree.size() - 1;
+			path p;
+			if (!planAgent(rules[side].agent, constraintsFor(index, rules[side].agent), &tree[index].paths, p)) {
+				tree.pop_back();
+				continue;
+			}
+			tree[index].paths[rules[side].agent] = std::make_shared<const path>(std::move(p));
+			std::vector<conflict> childFound;
+			findConflicts(tree[index].paths, childFound);
+			tree[index].cost = countCost(tree[index].paths);
+			tree[index].conflicts = childFound.size();
+			//Bypass: a child that costs no more but collides less is a better plan for this same node, so take its path
+			//and look at the node again instead of branching
+			if (tree[index].cost == tree[node].cost && tree[index].conflicts < tree[node].conflicts) {
+				tree[node].paths = tree[index].paths;
+				tree[node].conflicts = tree[index].conflicts;
+				tree.pop_back();
+				open.push(openEntry(tree[node].cost, tree[node].conflicts, node));
+				bypassed = true;
+				break;
+			}
+			children[side] = index;
+		}
+		if (bypassed)
+			continue;
+		for (int side = 0; side < 2; ++side) {
+			if (children[side] >= 0) {
+				open.push(openEntry(tree[children[side]].cost, tree[children[side]].conflicts, children[side]));
+			}
+		}
+	}
+
+	//Out of budget, or no way for everyone: plan one agent after another instead
+	treeNodes = tree.size();
+	solved = planInTurn(paths);
+	runtime = clock.getElapsedTime();
+	return solved;
+}
+
+ConflictSolver::constraintTable ConflictSolver::constraintsFor(int node, int agent) {
+	constraintTable rules;
+	for (int n = node; n > 0; n = tree[n].parent) {
+		const constraint& c = tree[n].added;
+		if (c.agent != agent)
+			continue;
+		if (c.from < 0) {
+			rules.tiles.insert(tileKey(c.step, c.tile));
+			if (c.tile == goals[agent]) {
+				rules.goalBlockedUntil = std::max(rules.goalBlockedUntil, c.step);
+			}
+		}
+		else {
+			rules.moves.insert(moveKey(c.step, c.from, c.tile));
+		}
+		rules.lastStep = std::max(rules.lastStep, c.step);
+	}
+	return rules;
+}
+
+bool ConflictSolver::planAgent(int agent, const constraintTable& rules, const std::vector<sharedPath>* others, path& result) {
+	//A* over (tile, step). Among equally short ways it takes the one running into the other agents' paths least
+	const std::vector<int>& steps = stepsToGoal[agent];
+	int goal = goals[agent];
+	std::unordered_map<uint64_t, int> occupied;
+	std::unordered_map<int, int> parkedFrom;
+	if (others != NULL) {
+		for (int a = 0; a < int(others->size()); ++a) {
+			const sharedPath& p = (*others)[a];
+			if (a == agent || !p)
+				continue;
+			for (int s = 0; s < int(p->size()); ++s) {
+				++occupied[tileKey(s, (*p)[s])];
+			}
+			parkedFrom[p->back()] = p->size() - 1;
+		}
+	}
+
+	struct lowNode {
+		int tile;
+		int step;
+		int parent;
+	};
+	std::vector<lowNode> nodes;
+	typedef std::tuple<int, int, int, int> openEntry; //f, collisions, -step, node
+	std::priority_queue<openEntry, std::vector<openEntry>, std::greater<openEntry>> open;
+	std::unordered_set<uint64_t> closed;
+	int start = starts[agent];
+	std::unordered_map<int, int>::const_iterator blocked = rules.blockedFrom.find(start);
+	if (rules.tiles.count(tileKey(0, start)) > 0 || (blocked != rules.blockedFrom.end() && blocked->second <= 0))
+		return false;
+	if (rules.blockedFrom.count(goal) > 0)
+		return false;
+	//Past the last constraint nothing changes with time, so later steps on a tile count as one state and the search ends
+	int settled = rules.lastStep + 1;
+	nodes.push_back(lowNode{ start, 0, -1 });
+	open.push(openEntry(steps[start], 0, 0, 0));
+
+	int around[9];
+	float costs[9];
+	while (!open.empty()) {
+		int index = std::get<3>(open.top());
+		int collisions = std::get<1>(open.top());
+		open.pop();
+		lowNode current = nodes[index];
+		if (!closed.insert(tileKey(std::min(current.step, settled), current.tile)).second)
+			continue;
+		++expansions;
+		if (current.tile == goal && current.step > rules.goalBlockedUntil) {
+			result.assign(current.step + 1, goal);
+			for (int n = index; n >= 0; n = nodes[n].parent) {
+				result[nodes[n].step] = nodes[n].tile;
+			}
+			return true;
+		}
+		int count = gridNeighbors(*mapref, current.tile, around, costs);
+		around[count++] = current.tile;
+		int step = current.step + 1;
+		for (int i = 0; i < count; ++i) {
+			int next = around[i];
+			if (steps[next] < 0 || closed.count(tileKey(std::min(step, settled), next)) > 0)
+				continue;
+			if (rules.tiles.count(tileKey(step, next)) > 0 || rules.moves.count(moveKey(step, current.tile, next)) > 0)
+				continue;
+			blocked = rules.blockedFrom.find(next);
+			if (blocked != rules.blockedFrom.end() && blocked->second <= step)
+				continue;
+			int added = 0;
+			if (others != NULL) {
+				std::unordered_map<uint64_t, int>::const_iterator hit = occupied.find(tileKey(step, next));
+				if (hit != occupied.end()) {
+					added += hit->second;
+				}
+				std::unordered_map<int, int>::const_iterator parked = parkedFrom.find(next);
+				if (parked != parkedFrom.end() && parked->second < step) {
+					++added;
+				}
+			}
+			nodes.push_back(lowNode{ next, step, index });
+			open.push(openEntry(step + steps[next], collisions + added, -step, nodes.size() - 1));
+		}
+	}
+	return false;
+}
+
+void ConflictSolver::findConflicts(const std::vector<sharedPath>& paths, std::vector<conflict>& found) {
+	//The first collision between each pair of agents
+	found.clear();
+	int agentCount = paths.size();
+	for (int a = 0; a < agentCount; ++a) {
+		const path& pa = *paths[a];
+		for (int b = a + 1; b < agentCount; ++b) {
+			const path& pb = *paths[b];
+			int length = std::max(pa.size(), pb.size());
+			for (int s = 0; s < length; ++s) {
+				if (at(pa, s) == at(pb, s)) {
+					found.push_back(conflict{ a, b, s, at(pa, s), at(pb, s), false });
+					break;
+				}
+				if (s + 1 < length && at(pa, s) == at(pb, s + 1) && at(pa, s + 1) == at(pb, s)) {
+					found.push_back(conflict{ a, b, s + 1, at(pa, s), at(pb, s), true });
+					break;
+				}
+			}
+		}
+	}
+}
+
+int ConflictSolver::countCost(const std::vector<sharedPath>& paths) {
+	int cost = 0;
+	for (const sharedPath& p : paths) {
+		cost += p->size() - 1;
+	}
+	return cost;
+}
+
+bool ConflictSolver::onlyTile(int node, int agent, int step, int tile, std::unordered_map<int, std::vector<int>>& singles) {
+	//Whether every shortest path the agent has under its constraints is on tile at step. The tiles those paths can be on
+	//at each step are found by walking forward from the start, keeping tiles from which the goal is still in time,
+	//and then back from the goal keeping only tiles that lead to it
+	std::unordered_map<int, std::vector<int>>::iterator known = singles.find(agent);
+	if (known == singles.end()) {
+		const path& p = *tree[node].paths[agent];
+		int cost = p.size() - 1;
+		constraintTable rules = constraintsFor(node, agent);
+		const std::vector<int>& steps = stepsToGoal[agent];
+		std::vector<std::vector<int>> levels(cost + 1);
+		levels[0].push_back(starts[agent]);
+		int around[9];
+		float costs[9];
+		for (int s = 0; s < cost; ++s) {
+			std::vector<int>& next = levels[s + 1];
+			for (int tile : levels[s]) {
+				int count = gridNeighbors(*mapref, tile, around, costs);
+				around[count++] = tile;
+				for (int i = 0; i < count; ++i) {
+					int n = around[i];
+					if (steps[n] < 0 || steps[n] > cost - (s + 1) || rules.tiles.count(tileKey(s + 1, n)) > 0 || rules.moves.count(moveKey(s + 1, tile, n)) > 0)
+						continue;
+					if (std::find(next.begin(), next.end(), n) == next.end()) {
+						next.push_back(n);
+					}
+				}
+			}
+		}
+		levels[cost].assign(1, goals[agent]);
+		for (int s = cost - 1; s >= 0; --s) {
+			std::vector<int> kept;
+			for (int tile : levels[s]) {
+				for (int n : levels[s + 1]) {
+					if (chebyshevDistance(*mapref, tile, n) <= 1 && rules.moves.count(moveKey(s + 1, tile, n)) == 0) {
+						kept.push_back(tile);
+						break;
+					}
+				}
+			}
+			levels[s].swap(kept);
+		}
+		std::vector<int> single(cost + 1);
+		for (int s = 0; s <= cost; ++s) {
+			single[s] = levels[s].size() == 1 ? levels[s][0] : -1;
+		}
+		known = singles.insert(std::make_pair(agent, single)).first;
+	}
+	const std::vector<int>& single = known->second;
+	//After arriving the agent waits on its goal, so moving it then always costs more
+	return step >= int(single.size()) ? tile == single.back() : single[step] == tile;
+}
+
+int ConflictSolver::pickConflict(int node, const std::vector<conflict>& found) {
+	//Branch on a collision that makes both agents' paths longer whichever way it's solved if there is one, since that
+	//raises the cost bound fastest. Next best is one that makes one agent's path longer
+	std::unordered_map<int, std::vector<int>> singles;
+	int best = 0;
+	int bestRank = -1;
+	for (int i = 0; i < int(found.size()) && bestRank < 2; ++i) {
+		const conflict& c = found[i];
+		bool forcedA, forcedB;
+		if (c.swap) {
+			forcedA = onlyTile(node, c.a, c.step - 1, c.tileA, singles) && onlyTile(node, c.a, c.step, c.tileB, singles);
+			forcedB = onlyTile(node, c.b, c.step - 1, c.tileB, singles) && onlyTile(node, c.b, c.step, c.tileA, singles);
+		}
+		else {
+			forcedA = onlyTile(node, c.a, c.step, c.tileA, singles);
+			forcedB = onlyTile(node, c.b, c.step, c.tileB, singles);
+		}
+		int rank = int(forcedA) + int(forcedB);
+		if (rank > bestRank) {
+			best = i;
+			bestRank = rank;
+		}
+	}
+	return best;
+}
+
+bool ConflictSolver::planInTurn(std::vector<std::vector<int>>& paths) {
+	//Prioritized planning: each agent keeps out of the way of the ones before it, including where they stop for good.
+	//An agent that can't get through goes first on the next attempt
+	int agentCount = starts.size();
+	std::vector<int> order(agentCount);
+	for (int a = 0; a < agentCount; ++a) {
+		order[a] = a;
+	}
+	for (int attempt = 0; attempt < maxFallbackAttempts; ++attempt) {
+		constraintTable rules;
+		sumOfCosts = 0;
+		int stuck = -1;
+		for (int i = 0; i < agentCount && stuck < 0; ++i) {
+			int a = order[i];
+			rules.goalBlockedUntil = -1;
+			for (int j = 0; j < i; ++j) {
+				const path& before = paths[order[j]];
+				for (int s = 0; s < int(before.size()); ++s) {
+					if (before[s] == goals[a]) {
+						rules.goalBlockedUntil = std::max(rules.goalBlockedUntil, s);
+					}
+				}
+			}
+			if (!planAgent(a, rules, NULL, paths[a])) {
+				stuck = i;
+				break;
+			}
+			const path& p = paths[a];
+			for (int s = 0; s < int(p.size()); ++s) {
+				rules.tiles.insert(tileKey(s, p[s]));
+				if (s > 0 && p[s] != p[s - 1]) {
+					//Later agents may not take the opposite move at the same time
+					rules.moves.insert(moveKey(s, p[s], p[s - 1]));
+				}
+			}
+			rules.blockedFrom[p.back()] = p.size() - 1;
+			rules.lastStep = std::max(rules.lastStep, int(p.size()) - 1);
+			sumOfCosts += p.size() - 1;
+		}
+		if (stuck < 0)
+			return true;
+		std::rotate(order.begin(), order.begin() + stuck, order.begin() + stuck + 1);
+	}
+	sumOfCosts = 0;
+	return false;
+}
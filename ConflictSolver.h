@@ -0,0 +1,84 @@
+#pragma once
+#include "Map.h"
+#include <unordered_set>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+
+//Finds collision free paths for a small group of agents with the fewest steps added up over all agents (conflict-based search).
+//Every agent plans alone, and where two plans collide the search branches on which of the two has to keep out of the way.
+//Paths move one tile per step like the crowd does, so a diagonal step takes as long as a straight one.
+//If the budget runs out first, agents are planned one after another instead, which is quick but not optimal
+class ConflictSolver {
+public:
+	Map* mapref;
+	int maxTreeNodes = 4000; //Branches tried before falling back
+	sf::Time timeLimit = sf::milliseconds(250);
+	int maxFallbackAttempts = 4; //Orders tried when planning agents one after another
+
+	//Results of the last solve
+	bool solved = false;
+	bool optimal = false; //False when the fallback found the paths, or nothing did
+	int treeNodes = 0;
+	int expansions = 0; //Low level search nodes
+	int sumOfCosts = 0; //Steps each agent takes before it stops on its goal for good, added up
+	sf::Time runtime;
+
+	ConflictSolver(Map& mref);
+	//paths[i] runs from starts[i] to goals[i] one tile per step, and the agent stays on its goal after the path ends
+	bool solve(const std::vector<int>& starts, const std::vector<int>& goals, std::vector<std::vector<int>>& paths);
+
+private:
+	typedef std::vector<int> path;
+	typedef std::shared_ptr<const path> sharedPath; //Tree nodes share the paths they didn't change
+
+	//Keep an agent out of a tile at a step, or off the move from one tile into another that ends at that step
+	struct constraint {
+		int agent;
+		int step;
+		int from; //-1 for a tile
+		int tile;
+	};
+	struct treeNode {
+		int parent;
+		constraint added;
+		std::vector<sharedPath> paths;
+		int cost;
+		int conflicts;
+	};
+	struct conflict {
+		int a;
+		int b;
+		int step; //Step a collision happens at, or the step a swap finishes at
+		int tileA; //Where a is at that step, and b came from when they swap
+		int tileB;
+		bool swap;
+	};
+	struct constraintTable {
+		std::unordered_set<uint64_t> tiles;
+		std::unordered_set<uint64_t> moves;
+		std::unordered_map<int, int> blockedFrom; //Tiles taken for good from a step on
+		int goalBlockedUntil = -1; //Last step the agent's goal is taken, it can only stop there after that
+		int lastStep = 0;
+	};
+
+	std::vector<int> starts;
+	std::vector<int> goals;
+	std::vector<std::vector<int>> stepsToGoal; //Per agent and tile, -1 where the goal can't be reached
+	std::vector<treeNode> tree;
+	sf::Clock clock;
+
+	uint64_t tileKey(int step, int tile) { return uint64_t(step) * mapref->tileCount + tile; }
+	uint64_t moveKey(int step, int from, int to) { return (uint64_t(step) * mapref->tileCount + from) * mapref->tileCount + to; }
+	static int at(const path& p, int step) { return p[std::min(step, int(p.size()) - 1)]; }
+
+	void measureSteps(int agent);
+	bool planAgent(int agent, const constraintTable& rules, const std::vector<sharedPath>* others, path& result);
+	constraintTable constraintsFor(int node, int agent);
+	void findConflicts(const std::vector<sharedPath>& paths, std::vector<conflict>& found);
+	int countCost(const std::vector<sharedPath>& paths);
+	int pickConflict(int node, const std::vector<conflict>& found);
+	bool onlyTile(int node, int agent, int step, int tile, std::unordered_map<int, std::vector<int>>& singles);
+	bool planInTurn(std::vector<std::vector<int>>& paths);
+	bool outOfBudget();
+};
@@ -0,0 +1,482 @@
+#include "stdafx.h"
+#include "ContractionHierarchy.h"
+#include "GridMoves.h"
+#include <algorithm>
+#include <limits>
+
+const float unreached = std::numeric_limits<float>::infinity();
+
+ContractionHierarchy::ContractionHierarchy(Map& mref) {
+	mapref = &mref;
+}
+
+void ContractionHierarchy::build(ThreadPool* pool) {
+	sf::Clock clock;
+	chooseNodes();
+	baseEdges.clear();
+	edgeTiles.clear();
+	//Every node searches out to the nodes around it. Threads take chunks of nodes, each with its own search arrays
+	int nodeCount = nodeTiles.size();
+	int chunkCount = pool != NULL ? int(pool->size()) * 4 : 1;
+	int chunkSize = (nodeCount + chunkCount - 1) / chunkCount;
+	std::vector<std::vector<baseEdge>> foundEdges(chunkCount);
+	std::vector<std::vector<int>> foundTiles(chunkCount);
+	std::function<void(int)> searchChunk = [&](int chunk) {
+		localSearch s;
+		for (int node = chunk * chunkSize; node < std::min(nodeCount, (chunk + 1) * chunkSize); ++node) {
+			searchLocal(s, nodeTiles[node], -1);
+			for (const std::pair<int, float>& other : s.reached) {
+				//Both ends find an edge, the lower numbered one keeps it
+				if (other.first <= node)
+					continue;
+				baseEdge edge;
+				edge.from = node;
+				edge.to = other.first;
+				edge.cost = other.second;
+				edge.firstTile = foundTiles[chunk].size();
+				for (int tile = nodeTiles[other.first]; tile >= 0; tile = s.parent[tile]) {
+					foundTiles[chunk].push_back(tile);
+				}
+				edge.tileCount = foundTiles[chunk].size() - edge.firstTile;
+				std::reverse(foundTiles[chunk].begin() + edge.firstTile, foundTiles[chunk].end());
+				foundEdges[chunk].push_back(edge);
+			}
+		}
+	};
+	if (pool != NULL) {
+		pool->parallelFor(chunkCount, searchChunk);
+	}
+	else {
+		searchChunk(0);
+	}
+	for (int chunk = 0; chunk < chunkCount; ++chunk) {
+		int offset = edgeTiles.size();
+		for (baseEdge edge : foundEdges[chunk]) {
+			edge.firstTile += offset;
+			baseEdges.push_back(edge);
+		}
+		edgeTiles.insert(edgeTiles.end(), foundTiles[chunk].begin(), foundTiles[chunk].end());
+	}
+	contract(pool);
+	for (int side = 0; side < 2; ++side) {
+		nodeCost[side].assign(nodeCount, 0.f);
+		nodeParent[side].assign(nodeCount, -1);
+		nodeStamp[side].assign(nodeCount, 0);
+	}
+	queryStamp = 0;
+	builtVersion = mapref->mapVersion;
+	buildTime = clock.getElapsedTime();
+}
+
+void ContractionHierarchy::chooseNodes() {
+	//A room can only be left through its ring of tiles, corners too since steps go diagonally, and a hall tile with two
+	//ground neighbors can only be passed along. So nodes on every ring tile and every other hall tile cut the map into
+	//pieces a local search can't leave without meeting one
+	const Map& map = *mapref;
+	nodeTiles.clear();
+	nodeOf.assign(map.tileCount, -1);
+	std::vector<bool> inRoom(map.tileCount, false);
+	std::vector<bool> onRing(map.tileCount, false);
+	for (const room& r : map.rooms) {
+		for (int y = std::max(r.position.y - 1, 0); y < std::min(r.position.y + r.size.y + 1, map.tilesPerCol); ++y) {
+			for (int x = std::max(r.position.x - 1, 0); x < std::min(r.position.x + r.size.x + 1, map.tilesPerRow); ++x) {
+				bool inside = x >= r.position.x && y >= r.position.y && x < r.position.x + r.size.x && y < r.position.y + r.size.y;
+				if (inside) {
+					inRoom[x + y * map.tilesPerRow] = true;
+				}
+				else {
+					onRing[x + y * map.tilesPerRow] = true;
+				}
+			}
+		}
+	}
+	int around[8];
+	float steps[8];
+	for (int tile = 0; tile < map.tileCount; ++tile) {
+		if (map.tiles[tile] != ground || inRoom[tile])
+			continue;
+		if (onRing[tile] || gridNeighbors(map, tile, around, steps) != 2) {
+			nodeOf[tile] = nodeTiles.size();
+			nodeTiles.push_back(tile);
+		}
+	}
+}
+
+void ContractionHierarchy::resetLocal(localSearch& s, int from) const {
+	int tileCount = mapref->tileCount;
+	if (int(s.cost.size()) != tileCount) {
+		s.cost.assign(tileCount, 0.f);
+		s.parent.assign(tileCount, -1);
+		s.stamp.assign(tileCount, 0);
+		s.current = 0;
+	}
+	if (++s.current == 0) {
+		std::fill(s.stamp.begin(), s.stamp.end(), 0);
+		s.current = 1;
+	}
+	s.reached.clear();
+	s.open.clear();
+	s.direct = unreached;
+	s.expansions = 0;
+	s.stamp[from] = s.current;
+	s.cost[from] = 0.f;
+	s.parent[from] = -1;
+}
+
+void ContractionHierarchy::searchLocal(localSearch& s, int from, int other) const {
+	//Every way on through a node is found from that node instead
+	const Map& map = *mapref;
+	resetLocal(s, from);
+	s.open.push_back(std::make_pair(0.f, from));
+	int around[8];
+	float steps[8];
+	while (!s.open.empty()) {
+		std::pop_heap(s.open.begin(), s.open.end(), std::greater<std::pair<float, int>>());
+		std::pair<float, int> top = s.open.back();
+		s.open.pop_back();
+		int tile = top.second;
+		if (top.first > s.cost[tile])
+			continue;
+		++s.expansions;
+		if (nodeOf[tile] >= 0) {
+			s.reached.push_back(std::make_pair(nodeOf[tile], top.first));
+			if (tile != from)
+				continue;
+		}
+		if (tile == other) {
+			s.direct = top.first;
+			break;
+		}
+		int count = gridNeighbors(map, tile, around, steps);
+		for (int i = 0; i < count; ++i) {
+			int next = around[i];
+			float d = top.first + steps[i];
+			if (s.stamp[next] != s.current || d < s.cost[next]) {
+				s.stamp[next] = s.current;
+				s.cost[next] = d;
+				s.parent[next] = tile;
+				s.open.push_back(std::make_pair(d, next));
+				std::push_heap(s.open.begin(), s.open.end(), std::greater<std::pair<float, int>>());
+			}
+		}
+	}
+}
+
+int ContractionHierarchy::neededShortcuts(int node, const std::vector<std::vector<arc>>& adjacency, const std::vector<bool>& contracted,
+	witnessSearch& witness, std::vector<shortcut>* out) const {
+	//A shortcut between two neighbors is needed unless another way between them, avoiding node, is as short
+	std::vector<const arc*> live;
+	for (const arc& a : adjacency[node]) {
+		if (!contracted[a.to]) {
+			live.push_back(&a);
+		}
+	}
+	if (int(witness.cost.size()) != int(nodeTiles.size())) {
+		witness.cost.assign(nodeTiles.size(), 0.f);
+		witness.stamp.assign(nodeTiles.size(), 0);
+		witness.current = 0;
+	}
+	int needed = 0;
+	for (size_t i = 0; i + 1 < live.size(); ++i) {
+		float limit = 0.f;
+		for (size_t j = i + 1; j < live.size(); ++j) {
+			limit = std::max(limit, live[i]->cost + live[j]->cost);
+		}
+		if (++witness.current == 0) {
+			std::fill(witness.stamp.begin(), witness.stamp.end(), 0);
+			witness.current = 1;
+		}
+		witness.open.clear();
+		witness.stamp[live[i]->to] = witness.current;
+		witness.cost[live[i]->to] = 0.f;
+		witness.open.push_back(std::make_pair(0.f, live[i]->to));
+		int settledNodes = 0;
+		while (!witness.open.empty() && settledNodes < witnessLimit) {
+			std::pop_heap(witness.open.begin(), witness.open.end(), std::greater<std::pair<float, int>>());
+			std::pair<float, int> top = witness.open.back();
+			witness.open.pop_back();
+			if (top.first > witness.cost[top.second])
+				continue;
+			if (top.first > limit)
+				break;
+			++settledNodes;
+			for (const arc& a : adjacency[top.second]) {
+				if (contracted[a.to] || a.to == node)
+					continue;
+				float d = top.first + a.cost;
+				if (witness.stamp[a.to] != witness.current || d < witness.cost[a.to]) {
+					witness.stamp[a.to] = witness.current;
+					witness.cost[a.to] = d;
+					witness.open.push_back(std::make_pair(d, a.to));
+					std::push_heap(witness.open.begin(), witness.open.end(), std::greater<std::pair<float, int>>());
+				}
+			}
+		}
+		//A way found but not settled is still a real way, so it counts as a witness too. Only a way no longer than the
+		//shortcut does, so queries stay exact. One that rounds a little longer just costs a spare shortcut
+		for (size_t j = i + 1; j < live.size(); ++j) {
+			float via = live[i]->cost + live[j]->cost;
+			if (witness.stamp[live[j]->to] == witness.current && witness.cost[live[j]->to] <= via)
+				continue;
+			++needed;
+			if (out != NULL) {
+				out->push_back(shortcut{ live[i]->to, live[j]->to, via });
+			}
+		}
+	}
+	return needed;
+}
+
+void ContractionHierarchy::contract(ThreadPool* pool) {
+	int nodeCount = nodeTiles.size();
+	std::vector<std::vector<arc>> adjacency(nodeCount);
+	for (size_t i = 0; i < baseEdges.size(); ++i) {
+		const baseEdge& edge = baseEdges[i];
+		adjacency[edge.from].push_back(arc{ edge.to, edge.cost, -1, int(i) });
+		adjacency[edge.to].push_back(arc{ edge.from, edge.cost, -1, int(i) });
+	}
+	std::vector<bool> contracted(nodeCount, false);
+	std::vector<int> removedNeighbors(nodeCount, 0);
+	//A node's priority is twice the shortcuts it needs less the edges it removes, plus its neighbors already contracted
+	//so the contraction spreads evenly. The first priorities are independent of each other
+	std::vector<std::pair<int, int>> order(nodeCount);
+	int chunkCount = pool != NULL ? int(pool->size()) * 4 : 1;
+	int chunkSize = (nodeCount + chunkCount - 1) / chunkCount;
+	std::function<void(int)> rateChunk = [&](int chunk) {
+		witnessSearch witness;
+		for (int node = chunk * chunkSize; node < std::min(nodeCount, (chunk + 1) * chunkSize); ++node) {
+			order[node] = std::make_pair(2 * (neededShortcuts(node, adjacency, contracted, witness, NULL) - int(adjacency[node].size())), node);
+		}
+	};
+	if (pool != NULL) {
+		pool->parallelFor(chunkCount, rateChunk);
+	}
+	else {
+		rateChunk(0);
+	}
+	std::make_heap(order.begin(), order.end(), std::greater<std::pair<int, int>>());
+	std::vector<std::vector<arc>> up(nodeCount);
+	rank.assign(nodeCount, 0);
+	shortcuts = 0;
+	witnessSearch witness;
+	std::vector<shortcut> added;
+	int nextRank = 0;
+	while (!order.empty()) {
+		std::pop_heap(order.begin(), order.end(), std::greater<std::pair<int, int>>());
+		int node = order.back().second;
+		order.pop_back();
+		if (contracted[node])
+			continue;
+		//Priorities go stale as neighbors are contracted, so check this one is still the lowest
+		added.clear();
+		int liveNeighbors = 0;
+		for (const arc& a : adjacency[node]) {
+			liveNeighbors += !contracted[a.to];
+		}
+		int priority = 2 * (neededShortcuts(node, adjacency, contracted, witness, &added) - liveNeighbors) + removedNeighbors[node];
+		if (!order.empty() && priority > order.front().first) {
+			order.push_back(std::make_pair(priority, node));
+			std::push_heap(order.begin(), order.end(), std::greater<std::pair<int, int>>());
+			continue;
+		}
+		contracted[node] = true;
+		rank[node] = nextRank++;
+		for (const arc& a : adjacency[node]) {
+			if (!contracted[a.to]) {
+				up[node].push_back(a);
+				++removedNeighbors[a.to];
+			}
+		}
+		for (const shortcut& s : added) {
+			auto link = [&](int a, int b) {
+				for (arc& existing : adjacency[a]) {
+					if (existing.to == b) {
+						if (s.cost < existing.cost) {
+							existing.cost = s.cost;
+							existing.middle = node;
+							existing.base = -1;
+						}
+						return;
+					}
+				}
+				adjacency[a].push_back(arc{ b, s.cost, node, -1 });
+			};
+			link(s.from, s.to);
+			link(s.to, s.from);
+			++shortcuts;
+		}
+	}
+	upStart.assign(nodeCount + 1, 0);
+	upArcs.clear();
+	for (int node = 0; node < nodeCount; ++node) {
+		upStart[node] = upArcs.size();
+		upArcs.insert(upArcs.end(), up[node].begin(), up[node].end());
+	}
+	upStart[nodeCount] = upArcs.size();
+}
+
+size_t ContractionHierarchy::memoryBytes() const {
+	return nodeOf.size() * sizeof(int) + nodeTiles.size() * sizeof(int) * 2 + upStart.size() * sizeof(int)
+		+ upArcs.size() * sizeof(arc) + baseEdges.size() * sizeof(baseEdge) + edgeTiles.size() * sizeof(int);
+}
+
+float ContractionHierarchy::search(int start, int goal) {
+	meeting = -1;
+	settled = 0;
+	fromStart.expansions = 0;
+	fromGoal.expansions = 0;
+	if (mapref->tiles[start] != ground || mapref->tiles[goal] != ground)
+		return unreached;
+	if (start == goal)
+		return 0.f;
+	//Both ends join the graph at the nodes around them. A node joins only at itself
+	localSearch* ends[2] = { &fromStart, &fromGoal };
+	int endTiles[2] = { start, goal };
+	for (int side = 0; side < 2; ++side) {
+		if (nodeOf[endTiles[side]] >= 0) {
+			ends[side]->reached.assign(1, std::make_pair(nodeOf[endTiles[side]], 0.f));
+			ends[side]->direct = unreached;
+		}
+		else {
+			searchLocal(*ends[side], endTiles[side], endTiles[1 - side]);
+		}
+	}
+	float best = fromStart.direct;
+	if (++queryStamp == 0) {
+		std::fill(nodeStamp[0].begin(), nodeStamp[0].end(), 0);
+		std::fill(nodeStamp[1].begin(), nodeStamp[1].end(), 0);
+		queryStamp = 1;
+	}
+	std::vector<std::pair<float, int>>* open = nodeOpen;
+	for (int side = 0; side < 2; ++side) {
+		open[side].clear();
+		for (const std::pair<int, float>& entry : ends[side]->reached) {
+			nodeStamp[side][entry.first] = queryStamp;
+			nodeCost[side][entry.first] = entry.second;
+			nodeParent[side][entry.first] = -1;
+			open[side].push_back(std::make_pair(entry.second, entry.first));
+		}
+		std::make_heap(open[side].begin(), open[side].end(), std::greater<std::pair<float, int>>());
+	}
+	//Climb from both ends, always on the side with the lower next node, until neither side can beat the best meeting
+	while (true) {
+		int side = -1;
+		float lowest = best;
+		for (int s = 0; s < 2; ++s) {
+			if (!open[s].empty() && open[s].front().first < lowest) {
+				lowest = open[s].front().first;
+				side = s;
+			}
+		}
+		if (side < 0)
+			break;
+		std::pop_heap(open[side].begin(), open[side].end(), std::greater<std::pair<float, int>>());
+		std::pair<float, int> top = open[side].back();
+		open[side].pop_back();
+		int node = top.second;
+		if (top.first > nodeCost[side][node])
+			continue;
+		//Stall on demand: a more important node reached more cheaply already has a shorter way here, so nothing
+		//found on from this node can be part of a shortest path
+		bool stalled = false;
+		for (int i = upStart[node]; i < upStart[node + 1] && !stalled; ++i) {
+			const arc& a = upArcs[i];
+			stalled = nodeStamp[side][a.to] == queryStamp && nodeCost[side][a.to] + a.cost < top.first;
+		}
+		if (stalled)
+			continue;
+		++settled;
+		if (nodeStamp[1 - side][node] == queryStamp && top.first + nodeCost[1 - side][node] < best) {
+			best = top.first + nodeCost[1 - side][node];
+			meeting = node;
+		}
+		for (int i = upStart[node]; i < upStart[node + 1]; ++i) {
+			const arc& a = upArcs[i];
+			float d = top.first + a.cost;
+			if (nodeStamp[side][a.to] != queryStamp || d < nodeCost[side][a.to]) {
+				nodeStamp[side][a.to] = queryStamp;
+				nodeCost[side][a.to] = d;
+				nodeParent[side][a.to] = node;
+				open[side].push_back(std::make_pair(d, a.to));
+				std::push_heap(open[side].begin(), open[side].end(), std::greater<std::pair<float, int>>());
+			}
+		}
+	}
+	return best;
+}
+
+float ContractionHierarchy::distance(int start, int goal) {
+	return search(start, goal);
+}
+
+const ContractionHierarchy::arc& ContractionHierarchy::findArc(int a, int b) const {
+	//The arc is kept by the less important end. It's always there, since a shortcut was added only between
+	//neighbors of the node it skips
+	int owner = rank[a] < rank[b] ? a : b;
+	int other = owner == a ? b : a;
+	int i = upStart[owner];
+	while (upArcs[i].to != other) {
+		++i;
+	}
+	return upArcs[i];
+}
+
+void ContractionHierarchy::unpack(int from, int to, const arc& way, std::vector<int>& out) const {
+	//Tiles after from's up to to's
+	if (way.middle >= 0) {
+		unpack(from, way.middle, findArc(from, way.middle), out);
+		unpack(way.middle, to, findArc(way.middle, to), out);
+		return;
+	}
+	const baseEdge& edge = baseEdges[way.base];
+	const int* tiles = &edgeTiles[edge.firstTile];
+	if (edge.from == from) {
+		out.insert(out.end(), tiles + 1, tiles + edge.tileCount);
+	}
+	else {
+		for (int i = edge.tileCount - 2; i >= 0; --i) {
+			out.push_back(tiles[i]);
+		}
+	}
+}
+
+searchResult ContractionHierarchy::path(int start, int goal) {
+	searchResult found;
+	float length = search(start, goal);
+	found.expansions = settled + fromStart.expansions + fromGoal.expansions;
+	if (length == unreached)
+		return found;
+	found.cost = length;
+	if (meeting < 0) {
+		//The ends met without passing a node, or are the same tile
+		for (int tile = goal; tile >= 0 && tile != start; tile = fromStart.parent[tile]) {
+			found.path.push_back(tile);
+		}
+		found.path.push_back(start);
+		std::reverse(found.path.begin(), found.path.end());
+		return found;
+	}
+	std::vector<int> chain;
+	for (int node = meeting; node >= 0; node = nodeParent[0][node]) {
+		chain.push_back(node);
+	}
+	std::reverse(chain.begin(), chain.end());
+	for (int node = nodeParent[1][meeting]; node >= 0; node = nodeParent[1][node]) {
+		chain.push_back(node);
+	}
+	//Start to the first node, the nodes, then the last node to the goal
+	for (int tile = nodeTiles[chain.front()]; tile >= 0 && tile != start; tile = fromStart.parent[tile]) {
+		found.path.push_back(tile);
+	}
+	found.path.push_back(start);
+	std::reverse(found.path.begin(), found.path.end());
+	for (size_t i = 1; i < chain.size(); ++i) {
+		unpack(chain[i - 1], chain[i], findArc(chain[i - 1], chain[i]), found.path);
+	}
+	if (nodeTiles[chain.back()] != goal) {
+		for (int tile = fromGoal.parent[nodeTiles[chain.back()]]; tile >= 0; tile = fromGoal.parent[tile]) {
+			found.path.push_back(tile);
+		}
+	}
+	return found;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "Map.h"
+#include "GridSearch.h"
+#include "ThreadPool.h"
+
+//Contraction hierarchy over a sparse graph of the map. The nodes are the doors around rooms and the hall tiles that aren't
+//in the middle of a one tile wide hall, and the edges the shortest ways between nodes that pass no other node, so distances
+//on the graph are exact.
+//Nodes are contracted from least to most important, with shortcuts added to keep the distances, and a query only climbs
+//towards more important nodes from both ends. Other tiles join the graph by a local search that stops at the nodes it meets
+class ContractionHierarchy {
+public:
+	Map* mapref;
+	int builtVersion = -1; //Map::mapVersion of the layout the graph was built on
+	sf::Time buildTime;
+	int witnessLimit = 64; //Nodes a witness search settles before giving up and adding the shortcut anyway
+	std::vector<int> nodeTiles;
+
+	ContractionHierarchy(Map& mref);
+	//The edges and first node priorities are searched on the pool when given one, the contraction itself is serial
+	void build(ThreadPool* pool = NULL);
+	bool current() const { return builtVersion == mapref->mapVersion && int(nodeOf.size()) == mapref->tileCount; }
+	size_t edgeCount() const { return baseEdges.size(); }
+	size_t shortcutCount() const { return shortcuts; }
+	size_t memoryBytes() const;
+
+	//Length of the shortest path between two tiles, infinity when there's none
+	float distance(int start, int goal);
+	//The path itself, every tile of it. Expansions count the tiles of both local searches and the nodes settled
+	searchResult path(int start, int goal);
+
+private:
+	struct baseEdge {
+		int from;
+		int to;
+		float cost;
+		int firstTile; //Tiles from `from` to `to`, both included, are edgeTiles[firstTile] on
+		int tileCount;
+	};
+	struct arc {
+		int to;
+		float cost;
+		int middle; //Node a shortcut skips, -1 for an edge
+		int base; //baseEdges index of an edge
+	};
+	//Dijkstra over tiles, one for each end of a query and one for each thread building edges
+	struct localSearch {
+		std::vector<float> cost;
+		std::vector<int> parent;
+		std::vector<unsigned> stamp;
+		unsigned current = 0;
+		std::vector<std::pair<float, int>> open;
+		std::vector<std::pair<int, float>> reached; //Nodes met and their distances
+		float direct = 0.f; //Distance to the other end when it was met before any node, else infinity
+		int expansions = 0;
+	};
+	//Dijkstra over the nodes not contracted yet, to find whether a shortcut is needed
+	struct witnessSearch {
+		std::vector<float> cost;
+		std::vector<unsigned> stamp;
+		unsigned current = 0;
+		std::vector<std::pair<float, int>> open;
+	};
+	struct shortcut {
+		int from;
+		int to;
+		float cost;
+	};
+
+	std::vector<int> nodeOf; //Node on each tile, -1 for none
+	std::vector<baseEdge> baseEdges;
+	std::vector<int> edgeTiles;
+	std::vector<int> rank; //Contraction order, higher is more important
+	std::vector<int> upStart; //Arcs to more important nodes are upArcs[upStart[node]] to upArcs[upStart[node + 1] - 1]
+	std::vector<arc> upArcs;
+	size_t shortcuts = 0;
+
+	//Query state. Node entries are only valid when their stamp matches, like GridSearch's tiles
+	localSearch fromStart;
+	localSearch fromGoal;
+	std::vector<float> nodeCost[2];
+	std::vector<int> nodeParent[2]; //Node each node was reached from, -1 for one the local search reached
+	std::vector<unsigned> nodeStamp[2];
+	unsigned queryStamp = 0;
+	std::vector<std::pair<float, int>> nodeOpen[2];
+	int meeting = -1; //Node where the best way between the ends climbs highest, -1 when it passes none
+	int settled = 0;
+
+	void chooseNodes();
+	void resetLocal(localSearch& s, int from) const;
+	void searchLocal(localSearch& s, int from, int other) const;
+	void contract(ThreadPool* pool);
+	int neededShortcuts(int node, const std::vector<std::vector<arc>>& adjacency, const std::vector<bool>& contracted,
+		witnessSearch& witness, std::vector<shortcut>* out) const;
+	float search(int start, int goal);
+	const arc& findArc(int a, int b) const;
+	void unpack(int from, int to, const arc& way, std::vector<int>& out) const;
+};
@@ -0,0 +1,179 @@
+#include "stdafx.h"
+#include "CooperativePlanner.h"
+#include "GridMoves.h"
+#include <algorithm>
+#include <queue>
+#include <cmath>
+
+CooperativePlanner::CooperativePlanner(Map& mref, int windowSteps, int replanSteps) {
+	mapref = &mref;
+	window = std::max(windowSteps, 1);
+	replanInterval = std::min(std::max(replanSteps, 1), window);
+}
+
+void CooperativePlanner::reset() {
+	distances.clear();
+}
+
+void CooperativePlanner::startReverse(reverseSearch& search, int goal, int origin) {
+	search.goal = goal;
+	search.origin = origin;
+	search.closed.clear();
+	search.bestCost.clear();
+	search.open.clear();
+	reverseNode first = { octileDistance(*mapref, goal, origin), 0.f, goal };
+	search.open.push_back(first);
+	search.bestCost[goal] = 0.f;
+}
+
+float CooperativePlanner::trueDistance(reverseSearch& search, int tile) {
+	std::unordered_map<int, float>::iterator known = search.closed.find(tile);
+	if (known != search.closed.end())
+		return known->second;
+	//Moves cost the same both ways, so searching out of the goal gives distances to it. The octile estimate is consistent,
+	//so every closed tile has its true distance even though the search was aimed at another tile
+	int around[8];
+	float costs[8];
+	while (!search.open.empty()) {
+		std::pop_heap(search.open.begin(), search.open.end(), std::greater<reverseNode>());
+		reverseNode current = search.open.back();
+		search.open.pop_back();
+		if (search.closed.count(current.tile) > 0)
+			continue;
+		search.closed[current.tile] = current.g;
+		int count = gridNeighbors(*mapref, current.tile, around, costs);
+		for (int i = 0; i < count; ++i) {
+			float g = current.g + costs[i];
+			std::unordered_map<int, float>::iterator best = search.bestCost.find(around[i]);
+			if (best != search.bestCost.end() && best->second <= g)
+				continue;
+			search.bestCost[around[i]] = g;
+			reverseNode next = { g + octileDistance(*mapref, around[i], search.origin), g, around[i] };
+			search.open.push_back(next);
+			std::push_heap(search.open.begin(), search.open.end(), std::greater<reverseNode>());
+		}
+		if (current.tile == tile)
+			return current.g;
+	}
+	return INFINITY;
+}
+
+void CooperativePlanner::plan(const std::vector<int>& starts, const std::vector<int>& goals, std::vector<std::vector<int>>& paths) {
+	int agentCount = starts.size();
+	paths.resize(agentCount);
+	if (int(distances.size()) != agentCount) {
+		distances.assign(agentCount, reverseSearch());
+	}
+	expansions = 0;
+
+	//Agents with no goal, or no way to it, stay put and are obstacles for everyone. Every plan starts the rest at a
+	//different agent, so no agent is always the one that has to give way
+	std::vector<int> staying;
+	std::vector<int> order;
+	for (int i = 0; i < agentCount; ++i) {
+		int agent = (i + planCount) % agentCount;
+		if (goals[agent] >= 0) {
+			reverseSearch& search = distances[agent];
+			if (search.goal != goals[agent]) {
+				startReverse(search, goals[agent], starts[agent]);
+			}
+			if (trueDistance(search, starts[agent]) != INFINITY) {
+				order.push_back(agent);
+				continue;
+			}
+		}
+		staying.push_back(agent);
+	}
+	++planCount;
+
+	std::vector<int> failed;
+	for (int attempt = 0; ; ++attempt) {
+		reservedTiles.clear();
+		reservedMoves.clear();
+		failed.clear();
+		for (int agent : staying) {
+			paths[agent].assign(window + 1, starts[agent]);
+			reserve(paths[agent]);
+		}
+		//Nobody may step onto an agent's tile before that agent has planned how to leave it
+		for (int agent : order) {
+			reservedTiles.insert(tileKey(1, starts[agent]));
+		}
+		for (int agent : order) {
+			reservedTiles.erase(tileKey(1, starts[agent]));
+			if (!planAgent(starts[agent], goals[agent], distances[agent], paths[agent])) {
+				//Boxed in by the agents before it. It waits here, which may be walked into
+				paths[agent].assign(window + 1, starts[agent]);
+				failed.push_back(agent);
+			}
+			reserve(paths[agent]);
+		}
+		if (failed.empty() || attempt == maxAttempts - 1)
+			break;
+		//Plan again with the boxed in agents first. The first agent can always wait where it is, so this settles quickly
+		std::stable_partition(order.begin(), order.end(), [&failed](int agent) {
+			return std::find(failed.begin(), failed.end(), agent) != failed.end();
+		});
+	}
+	failedAgents = failed.size();
+}
+
+bool CooperativePlanner::planAgent(int start, int goal, reverseSearch& search, std::vector<int>& path) {
+	//A* over (tile, step) up to the end of the window. Waiting is a move too, free once on the goal
+	typedef std::pair<float, int> openEntry; //f and node, smallest f first
+	std::priority_queue<openEntry, std::vector<openEntry>, std::greater<openEntry>> open;
+	std::unordered_set<uint64_t> closed;
+	nodes.clear();
+	float startDistance = trueDistance(search, start);
+	if (startDistance == INFINITY)
+		return false;
+	timeNode first = { start, 0, 0.f, -1 };
+	nodes.push_back(first);
+	open.push(openEntry(startDistance, 0));
+
+	int around[9];
+	float costs[9];
+	while (!open.empty()) {
+		int index = open.top().second;
+		open.pop();
+		timeNode current = nodes[index];
+		if (!closed.insert(tileKey(current.step, current.tile)).second)
+			continue;
+		++expansions;
+		if (current.step == window) {
+			path.assign(window + 1, start);
+			for (int n = index; n >= 0; n = nodes[n].parent) {
+				path[nodes[n].step] = nodes[n].tile;
+			}
+			return true;
+		}
+		int count = gridNeighbors(*mapref, current.tile, around, costs);
+		around[count] = current.tile;
+		costs[count] = current.tile == goal ? 0.f : 1.f;
+		++count;
+		int step = current.step + 1;
+		for (int i = 0; i < count; ++i) {
+			int next = around[i];
+			if (reservedTiles.count(tileKey(step, next)) > 0 || reservedMoves.count(moveKey(current.step, next, current.tile)) > 0)
+				continue;
+			if (closed.count(tileKey(step, next)) > 0)
+				continue;
+			float h = trueDistance(search, next);
+			if (h == INFINITY)
+				continue;
+			timeNode child = { next, step, current.g + costs[i], index };
+			nodes.push_back(child);
+			open.push(openEntry(child.g + h, nodes.size() - 1));
+		}
+	}
+	return false;
+}
+
+void CooperativePlanner::reserve(const std::vector<int>& path) {
+	for (int step = 0; step < int(path.size()); ++step) {
+		reservedTiles.insert(tileKey(step, path[step]));
+		if (step > 0 && path[step] != path[step - 1]) {
+			reservedMoves.insert(moveKey(step - 1, path[step - 1], path[step]));
+		}
+	}
+}
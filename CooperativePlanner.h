@@ -0,0 +1,61 @@
+#pragma once
+#include "Map.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+//Plans many agents together so they don't walk into each other (windowed hierarchical cooperative A*).
+//Agents plan one after another in (tile, step) space, avoiding the tiles and moves the agents before them reserved.
+//Each search only looks window steps ahead, and the rest of the way is the true distance from a reverse search
+//out of the agent's goal, which is only carried on as far as the agent needs instead of covering the whole map
+class CooperativePlanner {
+public:
+	Map* mapref;
+	int window; //Steps planned ahead for every agent
+	int replanInterval; //Steps walked before planning again, at most window
+	static const int maxAttempts = 4; //Times a plan is redone with the agents that got boxed in going first
+	int failedAgents = 0; //Agents still boxed in after the last plan's attempts, they wait and may be walked into
+	int expansions = 0; //Space-time nodes expanded on the last plan
+
+	CooperativePlanner(Map& mref, int windowSteps = 16, int replanSteps = 8);
+	//Plan the next window for every agent. paths[i] gets window + 1 tiles starting with starts[i], one per step,
+	//where a repeated tile means waiting. Agents with a goal of -1 stay where they are
+	void plan(const std::vector<int>& starts, const std::vector<int>& goals, std::vector<std::vector<int>>& paths);
+	//Forget the distances found so far, after the map changed
+	void reset();
+
+private:
+	struct reverseNode {
+		float f;
+		float g;
+		int tile;
+		bool operator > (const reverseNode& other) const { return f > other.f; }
+	};
+	//Distances to one goal, found by searching backwards from it and resumed whenever an unknown tile is asked for
+	struct reverseSearch {
+		int goal = -1;
+		int origin = -1; //Tile the search heads for, the agent's position when it started
+		std::unordered_map<int, float> closed;
+		std::unordered_map<int, float> bestCost;
+		std::vector<reverseNode> open; //A heap ordered by f
+	};
+	struct timeNode {
+		int tile;
+		int step;
+		float g;
+		int parent;
+	};
+
+	std::vector<reverseSearch> distances; //One per agent
+	std::unordered_set<uint64_t> reservedTiles; //(step, tile) pairs taken by agents already planned
+	std::unordered_set<uint64_t> reservedMoves; //(step, from, to) moves taken, to stop two agents swapping tiles
+	std::vector<timeNode> nodes;
+	unsigned planCount = 0;
+
+	float trueDistance(reverseSearch& search, int tile);
+	void startReverse(reverseSearch& search, int goal, int origin);
+	bool planAgent(int start, int goal, reverseSearch& search, std::vector<int>& path);
+	void reserve(const std::vector<int>& path);
+	uint64_t tileKey(int step, int tile) { return uint64_t(step) * mapref->tileCount + tile; }
+	uint64_t moveKey(int step, int from, int to) { return (uint64_t(step) * mapref->tileCount + from) * mapref->tileCount + to; }
+};
@@ -0,0 +1,168 @@
+#include "stdafx.h"
+#include "FirstMoveTable.h"
+#include "GridMoves.h"
+#include <algorithm>
+#include <fstream>
+
+const std::uint32_t fileMagic = 0x31445043; //"CPD1"
+
+FirstMoveTable::FirstMoveTable(Map& mref) {
+	mapref = &mref;
+}
+
+void FirstMoveTable::build(ThreadPool* pool) {
+	sf::Clock clock;
+	const Map& map = *mapref;
+	std::vector<std::vector<std::uint32_t>> rows(map.tileCount);
+	std::function<void(int)> buildRow = [&map, &rows](int source) {
+		if (map.tiles[source] != ground)
+			return;
+		std::vector<float> distances;
+		std::vector<std::uint8_t> moves;
+		measureDistances(map, source, distances, &moves);
+		encodeRow(map, source, moves, rows[source]);
+	};
+	if (pool != NULL) {
+		pool->parallelFor(map.tileCount, buildRow);
+	}
+	else {
+		for (int source = 0; source < map.tileCount; ++source) {
+			buildRow(source);
+		}
+	}
+	runs.clear();
+	rowStart.assign(map.tileCount + 1, 0);
+	for (int source = 0; source < map.tileCount; ++source) {
+		rowStart[source] = runs.size();
+		runs.insert(runs.end(), rows[source].begin(), rows[source].end());
+		std::vector<std::uint32_t>().swap(rows[source]);
+	}
+	rowStart[map.tileCount] = runs.size();
+	builtVersion = map.mapVersion;
+	buildTime = clock.getElapsedTime();
+}
+
+void FirstMoveTable::encodeRow(const Map& map, int source, const std::vector<std::uint8_t>& moves, std::vector<std::uint32_t>& out) {
+	//Only ground targets other than the source are ever asked for, so the rest never start a run
+	out.clear();
+	for (int tile = 0; tile < map.tileCount; ++tile) {
+		if (map.tiles[tile] != ground || tile == source)
+			continue;
+		if (out.empty()) {
+			out.push_back(moves[tile]);
+		}
+		else if ((out.back() & 15u) != moves[tile]) {
+			out.push_back(std::uint32_t(tile) << 4 | moves[tile]);
+		}
+	}
+}
+
+size_t FirstMoveTable::memoryBytes() const {
+	return (runs.size() + rowStart.size()) * sizeof(std::uint32_t);
+}
+
+std::uint8_t FirstMoveTable::firstMove(int from, int to) const {
+	const std::uint32_t* first = runs.data() + rowStart[from];
+	const std::uint32_t* last = runs.data() + rowStart[from + 1];
+	if (first == last)
+		return noMove;
+	//The last run starting at or before the target. The first run always starts at tile 0
+	const std::uint32_t* after = std::upper_bound(first, last, std::uint32_t(to) << 4 | 15u);
+	return std::uint8_t(after[-1] & 15u);
+}
+
+int FirstMoveTable::nextTile(int from, int to) const {
+	if (from == to || mapref->tiles[from] != ground || mapref->tiles[to] != ground)
+		return -1;
+	std::uint8_t move = firstMove(from, to);
+	return move == noMove ? -1 : applyMove(*mapref, from, move);
+}
+
+searchResult FirstMoveTable::path(int start, int goal) const {
+	searchResult found;
+	if (mapref->tiles[start] != ground || mapref->tiles[goal] != ground)
+		return found;
+	found.path.push_back(start);
+	for (int tile = start; tile != goal; ) {
+		std::uint8_t move = firstMove(tile, goal);
+		//Every step gets closer to the goal, so a path longer than the map can only come from a damaged table
+		if (move == noMove || int(found.path.size()) > mapref->tileCount) {
+			return searchResult();
+		}
+		//Moves to a corner are the even ones
+		found.cost += move % 2 == 0 ? diagonalCost : 1.f;
+		tile = applyMove(*mapref, tile, move);
+		if (tile < 0 || tile >= mapref->tileCount || mapref->tiles[tile] != ground) {
+			return searchResult();
+		}
+		found.path.push_back(tile);
+	}
+	return found;
+}
+
+std::uint32_t FirstMoveTable::checksum() const {
+	//FNV-1a over the size and the tiles
+	std::uint32_t hash = 2166136261u;
+	auto mix = [&hash](std::uint32_t value) {
+		hash = (hash ^ value) * 16777619u;
+	};
+	mix(mapref->tilesPerRow);
+	mix(mapref->tilesPerCol);
+	for (tiletype type : mapref->tiles) {
+		mix(type);
+	}
+	return hash;
+}
+
+bool FirstMoveTable::save(const std::string& path) const {
+	if (!current())
+		return false;
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+	std::uint32_t header[5] = { fileMagic, std::uint32_t(mapref->tilesPerRow), std::uint32_t(mapref->tilesPerCol), checksum(), std::uint32_t(runs.size()) };
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(rowStart.data()), rowStart.size() * sizeof(std::uint32_t));
+	file.write(reinterpret_cast<const char*>(runs.data()), runs.size() * sizeof(std::uint32_t));
+	return bool(file);
+}
+
+bool FirstMoveTable::load(const std::string& path) {
+	sf::Clock clock;
+	std::ifstream file(path, std::ios::binary);
+	std::uint32_t header[5];
+	if (!file.read(reinterpret_cast<char*>(header), sizeof(header)))
+		return false;
+	if (header[0] != fileMagic || header[1] != std::uint32_t(mapref->tilesPerRow) || header[2] != std::uint32_t(mapref->tilesPerCol)
+		|| header[3] != checksum())
+		return false;
+	std::vector<std::uint32_t> starts(mapref->tileCount + 1);
+	if (!file.read(reinterpret_cast<char*>(starts.data()), starts.size() * sizeof(std::uint32_t)))
+		return false;
+	//The run count of a damaged header could ask for any amount of memory, so it has to match what's left of the file
+	std::streampos runsBegin = file.tellg();
+	file.seekg(0, std::ios::end);
+	std::streamoff runBytes = file.tellg() - runsBegin;
+	file.seekg(runsBegin);
+	if (!file || runBytes != std::streamoff(header[4]) * std::streamoff(sizeof(std::uint32_t)))
+		return false;
+	std::vector<std::uint32_t> loaded(header[4]);
+	if (!file.read(reinterpret_cast<char*>(loaded.data()), loaded.size() * sizeof(std::uint32_t)))
+		return false;
+	//A damaged file mustn't send queries outside the runs
+	if (starts.back() != loaded.size() || !std::is_sorted(starts.begin(), starts.end()))
+		return false;
+	for (int source = 0; source < mapref->tileCount; ++source) {
+		if (starts[source] != starts[source + 1] && loaded[starts[source]] >> 4 != 0)
+			return false;
+	}
+	for (std::uint32_t run : loaded) {
+		if ((run & 15u) > 8u)
+			return false;
+	}
+	rowStart.swap(starts);
+	runs.swap(loaded);
+	builtVersion = mapref->mapVersion;
+	buildTime = clock.getElapsedTime();
+	return true;
+}
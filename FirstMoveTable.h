@@ -0,0 +1,42 @@
+#pragma once
+#include "Map.h"
+#include "GridSearch.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <string>
+
+//Compressed path database: for every pair of tiles, the first step of a shortest path between them. A path is
+//read off one step at a time with no search, for maps that don't change after they're generated.
+//Each source tile's row of first steps is run-length encoded over the target tiles in tile order, and walls
+//join whichever run they're next to since no path ends on them
+class FirstMoveTable {
+public:
+	Map* mapref;
+	int builtVersion = -1; //Map::mapVersion of the layout the table belongs to
+	sf::Time buildTime;
+
+	FirstMoveTable(Map& mref);
+	//One Dijkstra per ground tile, shared between the pool's threads when given one
+	void build(ThreadPool* pool = NULL);
+	bool current() const { return builtVersion == mapref->mapVersion && int(rowStart.size()) == mapref->tileCount + 1; }
+	//The file holds the tiles' checksum, and loading fails when it doesn't match the map's current tiles
+	bool save(const std::string& path) const;
+	bool load(const std::string& path);
+	size_t memoryBytes() const;
+	size_t runCount() const { return runs.size(); }
+
+	//Next tile on a shortest path from one tile to another, -1 when there's no way or they're the same tile
+	int nextTile(int from, int to) const;
+	//Every tile of a shortest path, the same shape of result as the grid searches, with no expansions
+	searchResult path(int start, int goal) const;
+
+private:
+	//Each run is its first target tile shifted left 4 bits and the step, from that tile to the next run's first.
+	//Sources' runs follow each other, starting at rowStart[source]
+	std::vector<std::uint32_t> runs;
+	std::vector<std::uint32_t> rowStart;
+
+	std::uint8_t firstMove(int from, int to) const;
+	std::uint32_t checksum() const;
+	static void encodeRow(const Map& map, int source, const std::vector<std::uint8_t>& moves, std::vector<std::uint32_t>& out);
+};
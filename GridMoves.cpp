@@ -0,0 +1,79 @@
+#include "stdafx.h"
+#include "GridMoves.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <limits>
+
+int gridNeighbors(const Map& map, int tile, int* out, float* costs) {
+	int x = tile % map.tilesPerRow;
+	int y = tile / map.tilesPerRow;
+	int count = 0;
+	for (int dy = -1; dy <= 1; ++dy) {
+		for (int dx = -1; dx <= 1; ++dx) {
+			int nx = x + dx;
+			int ny = y + dy;
+			if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= map.tilesPerRow || ny >= map.tilesPerCol)
+				continue;
+			int n = nx + ny * map.tilesPerRow;
+			if (map.tiles[n] != ground)
+				continue;
+			out[count] = n;
+			costs[count] = (dx != 0 && dy != 0) ? diagonalCost : 1.f;
+			++count;
+		}
+	}
+	return count;
+}
+
+float octileDistance(const Map& map, int a, int b) {
+	float dx = std::abs(float(a % map.tilesPerRow - b % map.tilesPerRow));
+	float dy = std::abs(float(a / map.tilesPerRow - b / map.tilesPerRow));
+	return std::max(dx, dy) + (diagonalCost - 1.f) * std::min(dx, dy);
+}
+
+int chebyshevDistance(const Map& map, int a, int b) {
+	return std::max(std::abs(a % map.tilesPerRow - b % map.tilesPerRow), std::abs(a / map.tilesPerRow - b / map.tilesPerRow));
+}
+
+std::uint8_t moveBetween(const Map& map, int from, int to) {
+	int dx = to % map.tilesPerRow - from % map.tilesPerRow;
+	int dy = to / map.tilesPerRow - from / map.tilesPerRow;
+	return std::uint8_t((dy + 1) * 3 + dx + 1);
+}
+
+int applyMove(const Map& map, int tile, std::uint8_t move) {
+	return tile + (move % 3 - 1) + (move / 3 - 1) * map.tilesPerRow;
+}
+
+void measureDistances(const Map& map, int source, std::vector<float>& distances, std::vector<std::uint8_t>* firstMoves) {
+	distances.assign(map.tileCount, std::numeric_limits<float>::infinity());
+	if (firstMoves != NULL) {
+		firstMoves->assign(map.tileCount, noMove);
+	}
+	std::vector<std::pair<float, int>> open;
+	distances[source] = 0.f;
+	open.push_back(std::make_pair(0.f, source));
+	int around[8];
+	float steps[8];
+	while (!open.empty()) {
+		std::pop_heap(open.begin(), open.end(), std::greater<std::pair<float, int>>());
+		std::pair<float, int> top = open.back();
+		open.pop_back();
+		if (top.first > distances[top.second])
+			continue;
+		int count = gridNeighbors(map, top.second, around, steps);
+		for (int i = 0; i < count; ++i) {
+			int next = around[i];
+			float d = top.first + steps[i];
+			if (d < distances[next]) {
+				distances[next] = d;
+				if (firstMoves != NULL) {
+					(*firstMoves)[next] = top.second == source ? moveBetween(map, source, next) : (*firstMoves)[top.second];
+				}
+				open.push_back(std::make_pair(d, next));
+				std::push_heap(open.begin(), open.end(), std::greater<std::pair<float, int>>());
+			}
+		}
+	}
+}
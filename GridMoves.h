@@ -0,0 +1,23 @@
+#pragma once
+#include "Map.h"
+#include <cstdint>
+
+//The moves the grid searches share: 8 directions between ground tiles, with diagonal steps costing more
+const float diagonalCost = 1.41421356f;
+
+//Write the ground tiles next to tile to out, with their step costs, and return how many there are.
+//Unlike Map::astar this never steps off one side of a row onto the other
+int gridNeighbors(const Map& map, int tile, int* out, float* costs);
+//Cheapest cost between two tiles if there were no walls
+float octileDistance(const Map& map, int a, int b);
+//Fewest steps between two tiles if there were no walls, when every step costs the same
+int chebyshevDistance(const Map& map, int a, int b);
+
+//A step to a neighboring tile as (dy + 1) * 3 + dx + 1, which makes staying on the tile noMove
+const std::uint8_t noMove = 4;
+std::uint8_t moveBetween(const Map& map, int from, int to);
+int applyMove(const Map& map, int tile, std::uint8_t move);
+
+//Cheapest cost from source to every tile by Dijkstra, infinity where there's no way. With firstMoves, also the step
+//each of those cheapest paths starts with, noMove for the source itself and tiles it can't reach
+void measureDistances(const Map& map, int source, std::vector<float>& distances, std::vector<std::uint8_t>* firstMoves = NULL);
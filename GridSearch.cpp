@@ -0,0 +1,750 @@
+#include "stdafx.h"
+#include "GridSearch.h"
+#include "GridMoves.h"
+#include "LineOfSight.h"
+#include "Landmarks.h"
+#include "FirstMoveTable.h"
+#include "ContractionHierarchy.h"
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+GridSearch::GridSearch(Map& mref) {
+	mapref = &mref;
+}
+
+void GridSearch::beginSearch() {
+	int tileCount = mapref->tileCount;
+	if (int(cost.size()) != tileCount) {
+		cost.assign(tileCount, 0.f);
+		parent.assign(tileCount, -1);
+		seenStamp.assign(tileCount, 0);
+		closedStamp.assign(tileCount, 0);
+		inconsistentStamp.assign(tileCount, 0);
+		fringeNext.assign(tileCount, -1);
+		fringePrev.assign(tileCount, -1);
+		stamp = 0;
+		closedMark = 0;
+	}
+	if (++stamp == 0) {
+		//The stamp wrapped around, so old stamps could look current
+		std::fill(seenStamp.begin(), seenStamp.end(), 0);
+		stamp = 1;
+	}
+	nextClosedMark();
+	open.clear();
+	result = searchResult();
+	anytimeStart = -1;
+}
+
+void GridSearch::nextClosedMark() {
+	if (++closedMark == 0) {
+		std::fill(closedStamp.begin(), closedStamp.end(), 0);
+		std::fill(inconsistentStamp.begin(), inconsistentStamp.end(), 0);
+		closedMark = 1;
+	}
+}
+
+float GridSearch::octileDistance(int a, int b) {
+	return ::octileDistance(*mapref, a, b);
+}
+
+float GridSearch::estimate(int tile, int goal) {
+	float h = octileDistance(tile, goal);
+	if (landmarks != NULL) {
+		h = std::max(h, landmarks->estimate(tile, goal));
+	}
+	return h;
+}
+
+void GridSearch::reach(int tile, float g, int from, float h) {
+	seenStamp[tile] = stamp;
+	cost[tile] = g;
+	parent[tile] = from;
+	open.push_back(std::make_pair(g + h, tile));
+	std::push_heap(open.begin(), open.end(), std::greater<std::pair<float, int>>());
+}
+
+int GridSearch::popOpen() {
+	//Skip copies of tiles that were closed since they were pushed
+	while (!open.empty()) {
+		std::pop_heap(open.begin(), open.end(), std::greater<std::pair<float, int>>());
+		int tile = open.back().second;
+		open.pop_back();
+		if (!closed(tile))
+			return tile;
+	}
+	return -1;
+}
+
+bool GridSearch::canSee(int from, int to) {
+	++result.sightChecks;
+	return clearOf(blockedTile, from, to) && lineOfSight(*mapref, from, to);
+}
+
+bool GridSearch::clearOf(int tile, int from, int to) {
+	if (tile >= 0 && tile != from && tile != to && from != to) {
+		//The line touches the blocked tile only if it passes within half a tile's diagonal of its centre. That counts a
+		//few lines that only pass its corner, which costs a waypoint at worst
+		int width = mapref->tilesPerRow;
+		float ax = float(from % width), ay = float(from / width);
+		float dx = float(to % width) - ax, dy = float(to / width) - ay;
+		float px = float(tile % width) - ax, py = float(tile / width) - ay;
+		float along = std::max(0.f, std::min(1.f, (px * dx + py * dy) / (dx * dx + dy * dy)));
+		float ox = px - along * dx, oy = py - along * dy;
+		if (ox * ox + oy * oy < 0.5f)
+			return false;
+	}
+	return true;
+}
+
+int GridSearch::neighbors(int tile, int* out, float* costs) {
+	int count = gridNeighbors(*mapref, tile, out, costs);
+	if (blockedTile < 0)
+		return count;
+	for (int i = 0; i < count; ++i) {
+		if (out[i] == blockedTile) {
+			--count;
+			out[i] = out[count];
+			costs[i] = costs[count];
+			break;
+		}
+	}
+	return count;
+}
+
+float GridSearch::distance(int a, int b) {
+	float dx = float(a % mapref->tilesPerRow - b % mapref->tilesPerRow);
+	float dy = float(a / mapref->tilesPerRow - b / mapref->tilesPerRow);
+	return std::sqrt(dx * dx + dy * dy);
+}
+
+void GridSearch::tracePath(int goal) {
+	for (int tile = goal; tile != -1; tile = parent[tile] == tile ? -1 : parent[tile]) {
+		result.path.push_back(tile);
+	}
+	std::reverse(result.path.begin(), result.path.end());
+	result.cost = cost[goal];
+}
+
+searchResult GridSearch::find(int start, int goal, searchMode mode) {
+	switch (mode) {
+	case thetaSearch:
+		return theta(start, goal, false);
+	case lazyThetaSearch:
+		return theta(start, goal, true);
+	case weightedSearch:
+		return weighted(start, goal, suboptimality);
+	case focalSearch:
+		return focal(start, goal, suboptimality);
+	case landmarkSearch:
+		return landmarkAstar(start, goal);
+	case firstMoveSearch:
+		if (mapref->firstMoves && mapref->firstMoves->current()) {
+			return mapref->firstMoves->path(start, goal);
+		}
+		return astar(start, goal);
+	case hierarchySearch:
+		if (mapref->hierarchy && mapref->hierarchy->current()) {
+			return mapref->hierarchy->path(start, goal);
+		}
+		return astar(start, goal);
+	case fringeSearch:
+		return fringe(start, goal);
+	case boundedSearch:
+		return bounded(start, goal);
+	case anytimeSearch:
+		return anytime(start, goal, anytimeBudget);
+	case smoothedSearch: {
+		searchResult grid = astar(start, goal);
+		searchResult smoothed = smooth(grid.path);
+		smoothed.expansions += grid.expansions;
+		smoothed.sightChecks += grid.sightChecks;
+		return smoothed;
+	}
+	default:
+		return astar(start, goal);
+	}
+}
+
+searchResult GridSearch::astar(int start, int goal) {
+	beginSearch();
+	if (mapref->tiles[start] != ground || mapref->tiles[goal] != ground)
+		return result;
+	reach(start, 0.f, start, estimate(start, goal));
+	int around[8];
+	float steps[8];
+	for (int tile = popOpen(); tile >= 0; tile = popOpen()) {
+		if (tile == goal) {
+			tracePath(goal);
+			return result;
+		}
+		close(tile);
+		++result.expansions;
+		int count = neighbors(tile, around, steps);
+		for (int i = 0; i < count; ++i) {
+			int next = around[i];
+			float g = cost[tile] + steps[i];
+			if (closed(next) || (seen(next) && g >= cost[next]))
+				continue;
+			reach(next, g, tile, estimate(next, goal));
+		}
+	}
+	return result;
+}
+
+searchResult GridSearch::landmarkAstar(int start, int goal) {
+	landmarks = &mapref->getLandmarks();
+	searchResult found = astar(start, goal);
+	landmarks = NULL;
+	return found;
+}
+
+searchResult GridSearch::fringe(int start, int goal) {
+	beginSearch();
+	if (mapref->tiles[start] != ground || mapref->tiles[goal] != ground)
+		return result;
+	//A tile is on the list while it's seen and not closed. Getting cheaper takes a closed tile back onto it
+	seenStamp[start] = stamp;
+	cost[start] = 0.f;
+	parent[start] = start;
+	fringeNext[start] = -1;
+	fringePrev[start] = -1;
+	int head = start;
+	float limit = estimate(start, goal);
+	int around[8];
+	float steps[8];
+	while (head >= 0) {
+		float nextLimit = INFINITY;
+		int tile = head;
+		while (tile >= 0) {
+			float f = cost[tile] + estimate(tile, goal);
+			if (f > limit) {
+				nextLimit = std::min(nextLimit, f);
+				tile = fringeNext[tile];
+				continue;
+			}
+			if (tile == goal) {
+				tracePath(goal);
+				return result;
+			}
+			++result.expansions;
+			int count = neighbors(tile, around, steps);
+			for (int i = 0; i < count; ++i) {
+				int next = around[i];
+				float g = cost[tile] + steps[i];
+				if (seen(next) && g >= cost[next])
+					continue;
+				if (seen(next) && !closed(next)) {
+					unlinkFringe(next, head);
+				}
+				seenStamp[next] = stamp;
+				closedStamp[next] = 0;
+				cost[next] = g;
+				parent[next] = tile;
+				//Right after this tile, so the pass looks at it next
+				fringePrev[next] = tile;
+				fringeNext[next] = fringeNext[tile];
+				if (fringeNext[tile] >= 0) {
+					fringePrev[fringeNext[tile]] = next;
+				}
+				fringeNext[tile] = next;
+			}
+			int after = fringeNext[tile];
+			unlinkFringe(tile, head);
+			close(tile);
+			tile = after;
+		}
+		limit = nextLimit;
+	}
+	return result;
+}
+
+void GridSearch::unlinkFringe(int tile, int& head) {
+	if (fringePrev[tile] >= 0) {
+		fringeNext[fringePrev[tile]] = fringeNext[tile];
+	}
+	else {
+		head = fringeNext[tile];
+	}
+	if (fringeNext[tile] >= 0) {
+		fringePrev[fringeNext[tile]] = fringePrev[tile];
+	}
+}
+
+searchResult GridSearch::bounded(int start, int goal) {
+	result = searchResult();
+	anytimeStart = -1;
+	if (mapref->tiles[start] != ground || mapref->tiles[goal] != ground)
+		return result;
+	size_t entries = std::max(boundedMemory / 4 * 3 / sizeof(boundedEntry), size_t(2));
+	size_t depths = std::max(boundedMemory / 4 / sizeof(boundedFrame), size_t(2));
+	if (boundedTable.size() != entries) {
+		boundedTable.assign(entries, boundedEntry{ -1, 0.f, 0.f, 0 });
+		boundedTable.shrink_to_fit();
+		boundedRound = 0;
+	}
+	if (boundedPath.size() != depths) {
+		boundedPath.resize(depths);
+		boundedPath.shrink_to_fit();
+	}
+	queryRound = boundedRound + 1;
+	//Every path under the last threshold was searched, so the shortest is at least the lowest f over it
+	float lowest = estimate(start, goal);
+	float limit = lowest;
+	float step = boundedStep;
+	bool cut = false;
+	//A round searching many more tiles than the table holds searches most of them again and again. It's given up, and
+	//the threshold raised twice as far from then on, which finds a longer path much sooner
+	int roundWork = int(entries) * 4;
+	int around[8];
+	float steps[8];
+	while (true) {
+		if (++boundedRound == 0) {
+			std::fill(boundedTable.begin(), boundedTable.end(), boundedEntry{ -1, 0.f, 0.f, 0 });
+			boundedRound = 1;
+			queryRound = 1;
+		}
+		float over = INFINITY;
+		int work = 0;
+		int depth = 0;
+		boundedPath[0] = boundedFrame{ start, 0.f, 0, INFINITY, {} };
+		remember(start, 0.f);
+		while (depth >= 0) {
+			boundedFrame& frame = boundedPath[depth];
+			if (frame.tile == goal) {
+				for (int i = 0; i <= depth; ++i) {
+					result.path.push_back(boundedPath[i].tile);
+				}
+				result.cost = frame.cost;
+				//Cut branches may have held a shorter path, so there's no bound then
+				result.bound = cut ? INFINITY : lowest > 0.f ? std::max(frame.cost / lowest, 1.f) : 1.f;
+				return result;
+			}
+			//Neighbors are listed again each time the search comes back to a tile, only their order is kept for every depth
+			int count = neighbors(frame.tile, around, steps);
+			if (frame.nextNeighbor == 0) {
+				++result.expansions;
+				if (++work > roundWork)
+					break;
+				float f[8];
+				for (int i = 0; i < count; ++i) {
+					f[i] = steps[i] + learned(around[i], goal);
+					frame.order[i] = std::uint8_t(i);
+				}
+				std::sort(frame.order, frame.order + count, [&](std::uint8_t a, std::uint8_t b) { return f[a] < f[b]; });
+			}
+			if (frame.nextNeighbor >= count) {
+				//The goal is no closer than through the best neighbor, which every later round and the tile's parent
+				//can use. The parent counts its step to this tile now, as its estimate has only grown
+				float h = std::max(learned(frame.tile, goal), frame.best);
+				learn(frame.tile, h);
+				if (--depth >= 0) {
+					boundedFrame& back = boundedPath[depth];
+					back.best = std::min(back.best, frame.cost - back.cost + h);
+				}
+				continue;
+			}
+			int i = frame.order[frame.nextNeighbor++];
+			int next = around[i];
+			float g = frame.cost + steps[i];
+			float h = learned(next, goal);
+			if ((depth > 0 && next == boundedPath[depth - 1].tile) || g + h > limit || !remember(next, g) || depth + 1 == int(depths)) {
+				frame.best = std::min(frame.best, steps[i] + h);
+				if (g + h > limit) {
+					over = std::min(over, g + h);
+				}
+				else if (depth + 1 == int(depths)) {
+					cut = true;
+				}
+				continue;
+			}
+			boundedPath[++depth] = boundedFrame{ next, g, 0, INFINITY, {} };
+		}
+		if (work > roundWork) {
+			if (std::isinf(limit))
+				return result;
+			step *= 2.f;
+			limit += step;
+			continue;
+		}
+		if (over == INFINITY)
+			return result;
+		lowest = over;
+		limit = std::max(over, limit + step);
+	}
+}
+
+GridSearch::boundedEntry* GridSearch::findEntry(int tile) {
+	//Each tile may be in either of two neighboring slots
+	size_t slot = (unsigned(tile) * 2654435761u) % (boundedTable.size() / 2) * 2;
+	for (size_t i = slot; i < slot + 2; ++i) {
+		if (boundedTable[i].tile == tile && boundedTable[i].round >= queryRound)
+			return &boundedTable[i];
+	}
+	return NULL;
+}
+
+GridSearch::boundedEntry* GridSearch::slotFor(int tile) {
+	//Push out an entry of an earlier query first, then one only holding an estimate, then the one reached at the higher
+	//cost, since the tiles nearest the start save the most searching. Losing an entry only means searching again
+	size_t slot = (unsigned(tile) * 2654435761u) % (boundedTable.size() / 2) * 2;
+	boundedEntry* a = &boundedTable[slot];
+	boundedEntry* b = &boundedTable[slot + 1];
+	if ((a->round < queryRound) != (b->round < queryRound))
+		return a->round < queryRound ? a : b;
+	if ((a->round < boundedRound) != (b->round < boundedRound))
+		return a->round < boundedRound ? a : b;
+	return a->cost >= b->cost ? a : b;
+}
+
+bool GridSearch::remember(int tile, float g) {
+	//False when the tile was already reached this round at no more cost
+	boundedEntry* entry = findEntry(tile);
+	if (entry == NULL) {
+		entry = slotFor(tile);
+		if (entry->round == boundedRound && entry->cost <= g)
+			return true;
+		*entry = boundedEntry{ tile, g, 0.f, boundedRound };
+		return true;
+	}
+	if (entry->round == boundedRound && entry->cost <= g)
+		return false;
+	entry->cost = g;
+	entry->round = boundedRound;
+	return true;
+}
+
+float GridSearch::learned(int tile, int goal) {
+	const boundedEntry* entry = findEntry(tile);
+	float h = estimate(tile, goal);
+	return entry != NULL ? std::max(h, entry->estimate) : h;
+}
+
+void GridSearch::learn(int tile, float estimate) {
+	boundedEntry* entry = findEntry(tile);
+	if (entry == NULL) {
+		entry = slotFor(tile);
+		if (entry->round == boundedRound)
+			return;
+		*entry = boundedEntry{ tile, INFINITY, 0.f, queryRound };
+	}
+	entry->estimate = estimate;
+}
+
+size_t GridSearch::memoryBytes() const {
+	return cost.capacity() * sizeof(float) + parent.capacity() * sizeof(int) + (seenStamp.capacity() + closedStamp.capacity()
+		+ inconsistentStamp.capacity()) * sizeof(unsigned) + (fringeNext.capacity() + fringePrev.capacity()) * sizeof(int)
+		+ open.capacity() * sizeof(std::pair<float, int>) + inconsistent.capacity() * sizeof(int)
+		+ boundedTable.capacity() * sizeof(boundedEntry) + boundedPath.capacity() * sizeof(boundedFrame);
+}
+
+searchResult GridSearch::theta(int start, int goal, bool lazy) {
+	beginSearch();
+	if (mapref->tiles[start] != ground || mapref->tiles[goal] != ground)
+		return result;
+	reach(start, 0.f, start, distance(start, goal));
+	int around[8];
+	float steps[8];
+	for (int tile = popOpen(); tile >= 0; tile = popOpen()) {
+		if (lazy && parent[tile] != tile && !canSee(parent[tile], tile)) {
+			//The parent was assumed visible when the tile was reached. It isn't, so take the best closed neighbor instead,
+			//which is always a valid grid step
+			int count = neighbors(tile, around, steps);
+			cost[tile] = INFINITY;
+			for (int i = 0; i < count; ++i) {
+				if (closed(around[i]) && cost[around[i]] + steps[i] < cost[tile]) {
+					cost[tile] = cost[around[i]] + steps[i];
+					parent[tile] = around[i];
+				}
+			}
+		}
+		if (tile == goal) {
+			tracePath(goal);
+			return result;
+		}
+		close(tile);
+		++result.expansions;
+		int from = parent[tile];
+		int count = neighbors(tile, around, steps);
+		for (int i = 0; i < count; ++i) {
+			int next = around[i];
+			if (closed(next))
+				continue;
+			//Go straight from this tile's parent when it can see the neighbor, otherwise step from this tile
+			float g;
+			int via;
+			if (from != tile && (lazy || canSee(from, next))) {
+				g = cost[from] + distance(from, next);
+				via = from;
+			}
+			else {
+				g = cost[tile] + steps[i];
+				via = tile;
+			}
+			if (seen(next) && g >= cost[next])
+				continue;
+			reach(next, g, via, distance(next, goal));
+		}
+	}
+	return result;
+}
+
+searchResult GridSearch::smooth(const std::vector<int>& path) {
+	searchResult smoothed;
+	if (path.empty())
+		return smoothed;
+	//Walk the path, keeping a corner only when the last kept tile can't see past it
+	smoothed.path.push_back(path[0]);
+	for (size_t i = 1; i + 1 < path.size(); ++i) {
+		++smoothed.sightChecks;
+		if (!clearOf(blockedTile, smoothed.path.back(), path[i + 1]) || !lineOfSight(*mapref, smoothed.path.back(), path[i + 1])) {
+			smoothed.cost += distance(smoothed.path.back(), path[i]);
+			smoothed.path.push_back(path[i]);
+		}
+	}
+	if (path.size() > 1) {
+		smoothed.cost += distance(smoothed.path.back(), path.back());
+		smoothed.path.push_back(path.back());
+	}
+	return smoothed;
+}
+
+void GridSearch::beginAnytime(int start, int goal, float startWeight, float step) {
+	beginSearch();
+	anytimeStart = start;
+	anytimeGoal = goal;
+	weight = std::max(startWeight, 1.f);
+	weightStep = std::max(step, 0.01f);
+	inconsistent.clear();
+	if (mapref->tiles[start] != ground || mapref->tiles[goal] != ground) {
+		anytimeStart = -1;
+		return;
+	}
+	seenStamp[goal] = stamp;
+	cost[goal] = INFINITY;
+	parent[goal] = -1;
+	reach(start, 0.f, start, 0.f);
+	open.back().first = weightedKey(start);
+	repairPath();
+}
+
+void GridSearch::repairPath() {
+	//Weighted A* that stops once nothing left open could beat the goal's cost. Tiles that get cheaper after they were
+	//closed this round aren't opened again, they wait for the next round
+	int around[8];
+	float steps[8];
+	while (!open.empty()) {
+		std::pair<float, int> top = open.front();
+		if (closed(top.second) || top.first > weightedKey(top.second) + 1e-4f) {
+			std::pop_heap(open.begin(), open.end(), std::greater<std::pair<float, int>>());
+			open.pop_back();
+			continue;
+		}
+		if (top.first >= cost[anytimeGoal])
+			break;
+		std::pop_heap(open.begin(), open.end(), std::greater<std::pair<float, int>>());
+		open.pop_back();
+		int tile = top.second;
+		close(tile);
+		++result.expansions;
+		int count = neighbors(tile, around, steps);
+		for (int i = 0; i < count; ++i) {
+			int next = around[i];
+			float g = cost[tile] + steps[i];
+			if (seen(next) && g >= cost[next])
+				continue;
+			seenStamp[next] = stamp;
+			cost[next] = g;
+			parent[next] = tile;
+			if (!closed(next)) {
+				open.push_back(std::make_pair(weightedKey(next), next));
+				std::push_heap(open.begin(), open.end(), std::greater<std::pair<float, int>>());
+			}
+			else if (inconsistentStamp[next] != closedMark) {
+				inconsistentStamp[next] = closedMark;
+				inconsistent.push_back(next);
+			}
+		}
+	}
+}
+
+bool GridSearch::improve() {
+	if (anytimeStart < 0 || weight <= 1.f || cost[anytimeGoal] == INFINITY)
+		return false;
+	weight = std::max(weight - weightStep, 1.f);
+	//Tiles still open and those waiting go back in once each with keys for the new weight, and every tile may be
+	//closed again. Entries left behind for tiles that were closed since are dropped. Waiting tiles carry this round's
+	//mark, which also keeps open tiles from going in twice, and the new round starts with none marked
+	for (const std::pair<float, int>& entry : open) {
+		if (!closed(entry.second) && inconsistentStamp[entry.second] != closedMark) {
+			inconsistentStamp[entry.second] = closedMark;
+			inconsistent.push_back(entry.second);
+		}
+	}
+	open.clear();
+	nextClosedMark();
+	for (int tile : inconsistent) {
+		open.push_back(std::make_pair(weightedKey(tile), tile));
+	}
+	inconsistent.clear();
+	std::make_heap(open.begin(), open.end(), std::greater<std::pair<float, int>>());
+	repairPath();
+	return weight > 1.f;
+}
+
+searchResult GridSearch::anytimeResult() {
+	searchResult best;
+	best.expansions = result.expansions;
+	if (anytimeStart < 0 || cost[anytimeGoal] == INFINITY)
+		return best;
+	for (int tile = anytimeGoal; tile != anytimeStart; tile = parent[tile]) {
+		best.path.push_back(tile);
+	}
+	best.path.push_back(anytimeStart);
+	std::reverse(best.path.begin(), best.path.end());
+	best.cost = cost[anytimeGoal];
+	//No path can be shorter than the lowest unweighted f of any tile still open or waiting
+	float lowest = cost[anytimeGoal];
+	for (const std::pair<float, int>& entry : open) {
+		if (!closed(entry.second)) {
+			lowest = std::min(lowest, cost[entry.second] + octileDistance(entry.second, anytimeGoal));
+		}
+	}
+	for (int tile : inconsistent) {
+		lowest = std::min(lowest, cost[tile] + octileDistance(tile, anytimeGoal));
+	}
+	best.bound = lowest > 0.f ? std::min(weight, best.cost / lowest) : 1.f;
+	return best;
+}
+
+searchResult GridSearch::anytime(int start, int goal, sf::Time budget) {
+	sf::Clock clock;
+	beginAnytime(start, goal);
+	while (clock.getElapsedTime() < budget && improve()) {
+	}
+	return anytimeResult();
+}
+
+void GridSearch::measureBound(float lowest, float weight) {
+	//The shortest path can't be shorter than lowest, as long as it counts every tile left open and every closed tile
+	//that was found cheaper afterwards. The weight bounds the path too, so keep whichever is tighter
+	result.bound = lowest > 0.f && lowest < result.cost ? std::min(result.cost / lowest, weight) : 1.f;
+}
+
+searchResult GridSearch::weighted(int start, int goal, float weight) {
+	beginSearch();
+	if (mapref->tiles[start] != ground || mapref->tiles[goal] != ground)
+		return result;
+	weight = std::max(weight, 1.f);
+	reach(start, 0.f, start, weight * octileDistance(start, goal));
+	//Lowest unweighted f of a closed tile that was found cheaper afterwards (the INCONS list of ARA*)
+	float reopenLowest = INFINITY;
+	int around[8];
+	float steps[8];
+	for (int tile = popOpen(); tile >= 0; tile = popOpen()) {
+		if (tile == goal) {
+			tracePath(goal);
+			float lowest = std::min(result.cost, reopenLowest);
+			for (const std::pair<float, int>& entry : open) {
+				if (!closed(entry.second)) {
+					lowest = std::min(lowest, cost[entry.second] + octileDistance(entry.second, goal));
+				}
+			}
+			measureBound(lowest, weight);
+			return result;
+		}
+		close(tile);
+		++result.expansions;
+		int count = neighbors(tile, around, steps);
+		for (int i = 0; i < count; ++i) {
+			int next = around[i];
+			float g = cost[tile] + steps[i];
+			//Closed tiles aren't opened again, which keeps the weight's bound, but a cheaper way to one still lowers the
+			//measured one
+			if (closed(next)) {
+				if (g < cost[next]) {
+					reopenLowest = std::min(reopenLowest, g + octileDistance(next, goal));
+				}
+				continue;
+			}
+			if (seen(next) && g >= cost[next])
+				continue;
+			reach(next, g, tile, weight * octileDistance(next, goal));
+		}
+	}
+	return result;
+}
+
+searchResult GridSearch::focal(int start, int goal, float weight) {
+	beginSearch();
+	if (mapref->tiles[start] != ground || mapref->tiles[goal] != ground)
+		return result;
+	weight = std::max(weight, 1.f);
+	//Open tiles ordered by f, for the lowest f and for the tiles that come within the bound as it rises.
+	//The focal list is the heap in open, ordered by distance to the goal, and a tile never leaves it since the bound only grows
+	std::set<std::pair<float, int>> byF;
+	float focalLimit = 0.f;
+	seenStamp[start] = stamp;
+	cost[start] = 0.f;
+	parent[start] = start;
+	byF.insert(std::make_pair(octileDistance(start, goal), start));
+	int around[8];
+	float steps[8];
+	while (!byF.empty()) {
+		//Tiles whose f is now within the bound join the focal list
+		float limit = weight * byF.begin()->first;
+		if (limit > focalLimit || open.empty()) {
+			for (std::set<std::pair<float, int>>::iterator it = byF.lower_bound(std::make_pair(focalLimit, -1)); it != byF.end() && it->first <= limit; ++it) {
+				open.push_back(std::make_pair(octileDistance(it->second, goal), it->second));
+				std::push_heap(open.begin(), open.end(), std::greater<std::pair<float, int>>());
+			}
+			focalLimit = limit;
+		}
+		//Skip entries for tiles that were expanded or got a new f since they were added
+		int tile = -1;
+		while (!open.empty()) {
+			std::pop_heap(open.begin(), open.end(), std::greater<std::pair<float, int>>());
+			int candidate = open.back().second;
+			open.pop_back();
+			float f = cost[candidate] + octileDistance(candidate, goal);
+			if (!closed(candidate) && f <= focalLimit && byF.count(std::make_pair(f, candidate)) > 0) {
+				tile = candidate;
+				break;
+			}
+		}
+		if (tile < 0)
+			continue;
+		float lowest = byF.begin()->first;
+		byF.erase(std::make_pair(cost[tile] + octileDistance(tile, goal), tile));
+		if (tile == goal) {
+			tracePath(goal);
+			measureBound(std::min(lowest, result.cost), weight);
+			return result;
+		}
+		close(tile);
+		++result.expansions;
+		int count = neighbors(tile, around, steps);
+		for (int i = 0; i < count; ++i) {
+			int next = around[i];
+			float g = cost[tile] + steps[i];
+			if (seen(next) && g >= cost[next])
+				continue;
+			//Expanding out of f order can reach a closed tile cheaper later, and it's opened again to keep the bound
+			float h = octileDistance(next, goal);
+			if (seen(next) && !closed(next)) {
+				byF.erase(std::make_pair(cost[next] + h, next));
+			}
+			closedStamp[next] = 0;
+			seenStamp[next] = stamp;
+			cost[next] = g;
+			parent[next] = tile;
+			byF.insert(std::make_pair(g + h, next));
+			if (g + h <= focalLimit) {
+				open.push_back(std::make_pair(h, next));
+				std::push_heap(open.begin(), open.end(), std::greater<std::pair<float, int>>());
+			}
+		}
+	}
+	return result;
+}
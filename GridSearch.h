@@ -0,0 +1,130 @@
+#pragma once
+#include "Map.h"
+#include <cstdint>
+
+//A finished search. Grid searches list every tile, any-angle searches only the corners where the path turns
+struct searchResult {
+	std::vector<int> path; //Start to goal, empty when there's no way
+	float cost = 0.f; //Length of the path in tiles
+	int expansions = 0;
+	int sightChecks = 0;
+	float bound = 1.f; //The path is at most this many times longer than the shortest one
+};
+
+//Path searches over a Map's tiles that reuse one set of per-tile arrays between queries, instead of allocating
+//them every time like Map::astar. Every search moves between ground tiles in 8 directions and measures in tiles
+class GridSearch {
+public:
+	Map* mapref;
+
+	GridSearch(Map& mref);
+	searchResult find(int start, int goal, searchMode mode);
+	int blockedTile = -1; //Ground tile every search treats as a wall, like one another unit stands on. -1 for none
+	searchResult astar(int start, int goal);
+	//Any-angle search (Theta*): a tile's parent may be any tile it can see, not only a neighbor.
+	//The lazy version only checks sight when a tile is expanded, which saves most of the checks
+	searchResult theta(int start, int goal, bool lazy);
+	//Drop every tile whose neighbors on the path can see each other (string pulling). Costs one sight check per tile
+	searchResult smooth(const std::vector<int>& path);
+
+	//Anytime search (ARA*). beginAnytime finds a path fast by trusting the heuristic weight times over, and each improve
+	//lowers the weight by weightStep and repairs the path, keeping the costs already found. Stop whenever the path is
+	//good enough. Any other search on this GridSearch ends the anytime search
+	void beginAnytime(int start, int goal, float weight = 3.f, float weightStep = 0.5f);
+	bool improve(); //False once the path is the shortest, or there's none
+	searchResult anytimeResult(); //Best path so far, with its bound
+	searchResult anytime(int start, int goal, sf::Time budget); //Begin and improve until the time runs out
+	sf::Time anytimeBudget = sf::microseconds(500); //Time anytimeSearch gets through find
+
+	//Weighted A*: trusting the heuristic weight times over finds a path at most weight times the shortest, usually much faster
+	searchResult weighted(int start, int goal, float weight);
+	//Focal search (A* epsilon): among the open tiles whose f is within weight of the lowest, expand the one closest to the goal.
+	//Same bound as weighted, but the bound is kept with the true heuristic, so the path is often closer to the shortest
+	searchResult focal(int start, int goal, float weight);
+	float suboptimality = 1.2f; //Weight weightedSearch and focalSearch get through find
+
+	//A* whose heuristic is also the lower bound from the map's landmarks (ALT), so far fewer tiles are expanded where walls
+	//make the way wind. The same paths as astar
+	searchResult landmarkAstar(int start, int goal);
+
+	//Fringe search: passes over a list of tiles in order, expanding the ones whose f is within a threshold and raising the
+	//threshold to the lowest f left over after each pass, so there's no heap to keep sorted. The same path lengths as astar
+	searchResult fringe(int start, int goal);
+
+	//Memory-bounded search (IDA* with a transposition table). Rounds of depth first search out to an f threshold, each
+	//raising it by at least boundedStep. A fixed table keeps the cheapest way to each tile this round, so other ways
+	//there aren't searched again, and the estimates learned from the tiles' neighbors, so later rounds skip dead ends.
+	//Uses none of the per-tile arrays, only boundedMemory bytes for the table and the path however big the map is.
+	//When the table is too small for the search, rounds are given up and the threshold raised faster, so less memory
+	//means longer paths rather than much longer searches. The result's bound tells how long. No path is found when
+	//the path is too long for its quarter of the memory
+	searchResult bounded(int start, int goal);
+	size_t boundedMemory = 64 * 1024;
+	float boundedStep = 1.f; //Paths may be about this many tiles longer than the shortest even when memory is plenty
+
+	size_t memoryBytes() const; //Every array the searches have made so far
+
+private:
+	//Per-tile search state. A tile's entries are only valid when its stamp matches the current search,
+	//so starting a search doesn't have to clear anything
+	std::vector<float> cost;
+	std::vector<int> parent;
+	std::vector<unsigned> seenStamp;
+	std::vector<unsigned> closedStamp;
+	std::vector<unsigned> inconsistentStamp;
+	std::vector<int> fringeNext; //Fringe search's list, through the tiles seen but not closed
+	std::vector<int> fringePrev;
+	unsigned stamp = 0;
+	unsigned closedMark = 0; //Separate from stamp, since an anytime search closes tiles anew every round
+	std::vector<std::pair<float, int>> open; //A heap by f. Tiles are pushed again when they get cheaper and old copies skipped
+	searchResult result;
+	std::vector<int> inconsistent; //Tiles that got cheaper after being closed this round
+	int anytimeStart = -1;
+	int anytimeGoal = -1;
+	float weight = 1.f;
+	float weightStep = 0.5f;
+	const Landmarks* landmarks = NULL; //Only set during landmarkAstar
+
+	//Memory-bounded search state. An entry's cost is only valid in its round, and its estimate for the rest of the query
+	struct boundedEntry {
+		int tile;
+		float cost; //Cheapest way to the tile this round
+		float estimate; //Learned lower bound on the way from the tile to the goal, 0 when none was learned
+		unsigned round;
+	};
+	struct boundedFrame {
+		int tile;
+		float cost;
+		int nextNeighbor;
+		float best; //Lowest step and estimate over the neighbors done so far
+		std::uint8_t order[8]; //Neighbors by lowest f first
+	};
+	std::vector<boundedEntry> boundedTable; //Three quarters of boundedMemory, the rest is boundedPath
+	std::vector<boundedFrame> boundedPath;
+	unsigned boundedRound = 0;
+	unsigned queryRound = 0; //First round of the current bounded search
+
+	void beginSearch();
+	bool seen(int tile) const { return seenStamp[tile] == stamp; }
+	bool closed(int tile) const { return closedStamp[tile] == closedMark; }
+	void close(int tile) { closedStamp[tile] = closedMark; }
+	void nextClosedMark();
+	void reach(int tile, float g, int from, float h);
+	int popOpen();
+	bool canSee(int from, int to);
+	bool clearOf(int tile, int from, int to);
+	int neighbors(int tile, int* out, float* costs);
+	float distance(int a, int b);
+	void tracePath(int goal);
+	float weightedKey(int tile) { return cost[tile] + weight * octileDistance(tile, anytimeGoal); }
+	float octileDistance(int a, int b);
+	float estimate(int tile, int goal);
+	void repairPath();
+	void unlinkFringe(int tile, int& head);
+	boundedEntry* findEntry(int tile);
+	boundedEntry* slotFor(int tile);
+	bool remember(int tile, float g);
+	float learned(int tile, int goal);
+	void learn(int tile, float estimate);
+	void measureBound(float lowest, float weight);
+};
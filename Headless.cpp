@@ -0,0 +1,674 @@
+#include "stdafx.h"
+#include "Headless.h"
+#include "Map.h"
+#include "Simulation.h"
+#include "ConflictSolver.h"
+#include "GridSearch.h"
+#include "LineOfSight.h"
+#include "Landmarks.h"
+#include "FirstMoveTable.h"
+#include "ContractionHierarchy.h"
+#include "MapGenerator.h"
+#include "World.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+const int headlessTilePixels = 32; //Pixel size the map would be drawn at, only used for tile positions
+
+//Every ground tile of the map
+static std::vector<int> groundTiles(const Map& map) {
+	std::vector<int> tiles;
+	for (int i = 0; i < map.tileCount; ++i) {
+		if (map.tiles[i] == ground) {
+			tiles.push_back(i);
+		}
+	}
+	return tiles;
+}
+
+//Random pairs of ground tiles, the same ones every time for the same map seed. None when there's no ground
+static std::vector<std::pair<int, int>> randomPairs(const Map& map, int count) {
+	std::vector<std::pair<int, int>> pairs;
+	std::vector<int> tiles = groundTiles(map);
+	if (tiles.empty())
+		return pairs;
+	std::minstd_rand random(map.currentSeed);
+	std::uniform_int_distribution<int> pickTile(0, tiles.size() - 1);
+	for (int i = 0; i < count; ++i) {
+		int from = tiles[pickTile(random)];
+		pairs.push_back(std::make_pair(from, tiles[pickTile(random)]));
+	}
+	return pairs;
+}
+
+//Searching a path per unit would take longer than the run, so units share a few routes and start spread along them
+static bool spawnCrowd(Map& map, UnitSystem& crowd, int count, int routeCount) {
+	std::vector<std::pair<int, int>> ends = randomPairs(map, routeCount);
+	if (ends.empty())
+		return false;
+	std::vector<std::vector<int>> routes;
+	for (const std::pair<int, int>& e : ends) {
+		std::list<int> path = map.astar(e.first, e.second);
+		routes.emplace_back(path.begin(), path.end());
+	}
+	std::minstd_rand random(map.currentSeed);
+	for (int i = 0; i < count; ++i) {
+		const std::vector<int>& route = routes[i % routeCount];
+		int cursor = std::uniform_int_distribution<int>(0, route.size() - 1)(random);
+		int unit = crowd.addUnit(i % 2 == 1, route[cursor], true);
+		crowd.setPath(unit, route.data(), route.size());
+		crowd.pathCursor[unit] = cursor;
+	}
+	return true;
+}
+
+//Units start and end on different random tiles, and only the planner moves them
+static bool spawnSwarm(Map& map, UnitSystem& crowd, int count) {
+	std::vector<int> freeTiles = groundTiles(map);
+	freeTiles.erase(std::remove_if(freeTiles.begin(), freeTiles.end(), [&](int tile) { return crowd.index.occupied(tile); }), freeTiles.end());
+	if (int(freeTiles.size()) < count)
+		return false;
+	std::minstd_rand random(map.currentSeed);
+	std::shuffle(freeTiles.begin(), freeTiles.end(), random);
+	std::vector<int> goals(freeTiles.begin(), freeTiles.begin() + count);
+	std::shuffle(goals.begin(), goals.end(), random);
+	for (int i = 0; i < count; ++i) {
+		int unit = crowd.addUnit(i % 2 == 1, freeTiles[i]);
+		crowd.goal[unit] = goals[i];
+	}
+	return true;
+}
+
+//Every search mode on the same random pairs of ground tiles, with average time, work and path shape. The memory-bounded
+//search gets a row for memoryKB, then each quarter of it down to 4 KB
+static void benchmarkSearches(Map& map, int pairs, float weight, int memoryKB) {
+	std::vector<std::pair<int, int>> queries = randomPairs(map, pairs);
+	if (queries.empty())
+		return;
+	struct modeName {
+		searchMode mode;
+		std::string name;
+		int memoryKB;
+	};
+	std::vector<modeName> modes = {
+		{ classicSearch, "classic", 0 },
+		{ astarSearch, "astar", 0 },
+		{ thetaSearch, "theta", 0 },
+		{ lazyThetaSearch, "lazytheta", 0 },
+		{ smoothedSearch, "smoothed", 0 },
+		{ anytimeSearch, "anytime", 0 },
+		{ weightedSearch, "weighted", 0 },
+		{ focalSearch, "focal", 0 },
+		{ landmarkSearch, "landmarks", 0 },
+		{ firstMoveSearch, "firstmoves", 0 },
+		{ hierarchySearch, "hierarchy", 0 },
+		{ fringeSearch, "fringe", 0 }
+	};
+	for (int kb = memoryKB; kb >= 4; kb /= 4) {
+		modes.push_back({ boundedSearch, "bounded " + std::to_string(kb) + "KB", kb });
+	}
+	//Landmarks are measured once per map, so measure them before the timing
+	map.getLandmarks();
+	GridSearch search(map);
+	search.suboptimality = weight;
+	//Shortest grid path of every pair, to see how far the faster modes stray from it
+	std::vector<float> shortest;
+	for (const std::pair<int, int>& q : queries) {
+		shortest.push_back(search.astar(q.first, q.second).cost);
+	}
+	std::cout << "per-tile arrays: " << search.memoryBytes() / 1024 << " KB\n";
+	std::cout << "mode  avg us  expansions  sight checks  waypoints  length  avg ratio  max ratio  no path\n";
+	for (const modeName& m : modes) {
+		//Without a table or hierarchy these are only astar again
+		if (m.mode == firstMoveSearch && !(map.firstMoves && map.firstMoves->current()))
+			continue;
+		if (m.mode == hierarchySearch && !(map.hierarchy && map.hierarchy->current()))
+			continue;
+		if (m.mode == boundedSearch) {
+			search.boundedMemory = size_t(m.memoryKB) * 1024;
+		}
+		long long expansions = 0, sightChecks = 0, waypoints = 0;
+		double length = 0.0, ratio = 0.0, worstRatio = 0.0;
+		int failed = 0;
+		sf::Clock clock;
+		for (size_t n = 0; n < queries.size(); ++n) {
+			const std::pair<int, int>& q = queries[n];
+			searchResult found;
+			if (m.mode == classicSearch) {
+				std::list<int> path = map.astar(q.first, q.second);
+				if (path.back() == q.second) {
+					found.path.assign(path.begin(), path.end());
+				}
+			}
+			else {
+				found = search.find(q.first, q.second, m.mode);
+			}
+			if (found.path.empty()) {
+				++failed;
+				continue;
+			}
+			double pathLength = 0.0;
+			for (size_t i = 1; i < found.path.size(); ++i) {
+				float dx = float(found.path[i] % map.tilesPerRow - found.path[i - 1] % map.tilesPerRow);
+				float dy = float(found.path[i] / map.tilesPerRow - found.path[i - 1] / map.tilesPerRow);
+				pathLength += std::sqrt(dx * dx + dy * dy);
+			}
+			length += pathLength;
+			double pathRatio = shortest[n] > 0.f ? pathLength / shortest[n] : 1.0;
+			ratio += pathRatio;
+			worstRatio = std::max(worstRatio, pathRatio);
+			expansions += found.expansions;
+			sightChecks += found.sightChecks;
+			waypoints += found.path.size();
+		}
+		float micros = clock.getElapsedTime().asMicroseconds() / float(pairs);
+		int solved = std::max(pairs - failed, 1);
+		std::cout << m.name << "  " << micros << "  " << expansions / solved << "  " << sightChecks / solved << "  "
+			<< waypoints / solved << "  " << length / solved << "  " << ratio / solved << "  " << worstRatio << "  " << failed << "\n";
+	}
+}
+
+//A random ground tile of a world chunk, or the chunk's corner when it has none
+static sf::Vector2i groundInChunk(World& world, sf::Vector2i coord, std::minstd_rand& random) {
+	int size = world.tilesPerChunk();
+	std::uniform_int_distribution<int> pick(0, size * size - 1);
+	int first = pick(random);
+	for (int i = 0; i < size * size; ++i) {
+		int n = (first + i) % (size * size);
+		sf::Vector2i tile = coord * size + sf::Vector2i(n % size, n / size);
+		if (world.getTile(tile) == ground)
+			return tile;
+	}
+	return coord * size;
+}
+
+//Walkers that keep crossing the world to chunks a few away, one tile per tick. The chunks around them are loaded
+//and the rest evicted every tick, so memory stays within the world's chunk budget however far they go
+static void roamWorld(World& world, int walkerCount, int ticks, int radius) {
+	std::minstd_rand random(walkerCount * 7919 + ticks);
+	std::uniform_int_distribution<int> pickOffset(-4, 4);
+	std::vector<sf::Vector2i> positions;
+	std::vector<std::list<sf::Vector2i>> paths(walkerCount);
+	for (int i = 0; i < walkerCount; ++i) {
+		positions.push_back(groundInChunk(world, sf::Vector2i(i, 0), random));
+	}
+	int found = 0, failed = 0, mostLoaded = 0;
+	sf::Clock clock;
+	for (int tick = 0; tick < ticks; ++tick) {
+		for (int i = 0; i < walkerCount; ++i) {
+			if (paths[i].empty()) {
+				sf::Vector2i target = groundInChunk(world, world.chunkOf(positions[i]) + sf::Vector2i(pickOffset(random), pickOffset(random)), random);
+				paths[i] = world.astar(positions[i], target);
+				//A failed search returns only the start
+				if (paths[i].back() == target) {
+					++found;
+				}
+				else {
+					++failed;
+				}
+				paths[i].pop_front();
+				continue;
+			}
+			positions[i] = paths[i].front();
+			paths[i].pop_front();
+		}
+		world.update(positions, radius);
+		mostLoaded = std::max(mostLoaded, world.loadedChunks());
+	}
+	std::cout << ticks << " ticks in " << clock.getElapsedTime().asMilliseconds() << " ms, " << found << " paths, " << failed
+		<< " failed, at most " << mostLoaded << " of " << world.chunkBudget() << " chunks loaded\n";
+}
+
+//Time single sight lines, one origin against a batch of targets, and fields of view, all from random ground tiles
+static void benchmarkSight(Map& map, int queries, int radius) {
+	const int batchSize = 64;
+	std::vector<std::pair<int, int>> lines = randomPairs(map, std::max(queries, batchSize));
+	if (lines.empty())
+		return;
+	std::vector<int> origins(queries);
+	std::vector<int> targets(batchSize);
+	for (int i = 0; i < queries; ++i) {
+		origins[i] = lines[i].first;
+	}
+	for (int i = 0; i < batchSize; ++i) {
+		targets[i] = lines[i].second;
+	}
+	std::vector<uint8_t> visible(batchSize);
+
+	int seen = 0;
+	sf::Clock clock;
+	for (int i = 0; i < queries; ++i) {
+		seen += lineOfSight(map, origins[i], targets[i % batchSize]);
+	}
+	std::cout << "line: " << clock.restart().asMicroseconds() / float(queries) << " us, " << seen << "/" << queries << " clear\n";
+	seen = 0;
+	for (int i = 0; i < queries; ++i) {
+		seen += lineOfSightMany(map, origins[i], targets.data(), batchSize, visible.data(), float(radius));
+	}
+	std::cout << "batch of " << batchSize << " within " << radius << ": " << clock.restart().asMicroseconds() / float(queries)
+		<< " us, " << seen / float(queries) << " visible\n";
+	FieldOfView view(map);
+	long long tilesSeen = 0;
+	for (int i = 0; i < queries; ++i) {
+		view.compute(origins[i], radius);
+		tilesSeen += view.visibleTiles.size();
+	}
+	std::cout << "field of view " << radius << ": " << clock.restart().asMicroseconds() / float(queries) << " us, "
+		<< tilesSeen / queries << " tiles seen\n";
+}
+
+//Success rate and runtime of the conflict solver on random starts and goals, for growing groups of agents
+static void benchmarkSolver(Map& map, ConflictSolver& solver, int maxAgents, int agentStep, int trials) {
+	std::vector<int> tiles = groundTiles(map);
+	std::minstd_rand random(map.currentSeed);
+	std::cout << "agents  optimal  fallback  failed  avg ms  avg nodes\n";
+	for (int agents = agentStep; agents <= maxAgents && agents * 2 <= int(tiles.size()); agents += agentStep) {
+		int optimal = 0, fallback = 0, failed = 0;
+		long long nodes = 0;
+		sf::Time total;
+		for (int t = 0; t < trials; ++t) {
+			std::shuffle(tiles.begin(), tiles.end(), random);
+			std::vector<int> starts(tiles.begin(), tiles.begin() + agents);
+			std::vector<int> goals(tiles.begin() + agents, tiles.begin() + agents * 2);
+			std::vector<std::vector<int>> paths;
+			solver.solve(starts, goals, paths);
+			optimal += solver.optimal;
+			fallback += solver.solved && !solver.optimal;
+			failed += !solver.solved;
+			nodes += solver.treeNodes;
+			total += solver.runtime;
+		}
+		std::cout << agents << "  " << optimal * 100 / trials << "%  " << fallback * 100 / trials << "%  "
+			<< failed * 100 / trials << "%  " << total.asSeconds() * 1000.f / trials << "  " << nodes / trials << "\n";
+	}
+}
+
+static int runScript(std::istream& script) {
+	std::unique_ptr<Map> map;
+	std::unique_ptr<CooperativePlanner> planner;
+	std::unique_ptr<Simulation> sim;
+	std::unique_ptr<World> world;
+	std::vector<Unit*> units;
+	sf::Time step = sf::Time::Zero;
+	bool clickDown = false;
+	unsigned totalTicks = 0;
+	sf::Time totalTime;
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(script, line)) {
+		++lineNumber;
+		line = line.substr(0, line.find('#'));
+		std::istringstream words(line);
+		std::string command;
+		if (!(words >> command))
+			continue;
+
+		bool ok = true;
+		if (command == "map") {
+			int w, h;
+			//Smaller maps have no space for the generator to place a room
+			int smallest = MapGenerator::smallestSide(genParams());
+			ok = bool(words >> w >> h) && w >= smallest && h >= smallest;
+			if (ok) {
+				//The simulation and planner point into the map, so they go first
+				sim.reset();
+				planner.reset();
+				units.clear();
+				map.reset(new Map(sf::Vector2u(w * headlessTilePixels, h * headlessTilePixels), w, h));
+				sim.reset(new Simulation(*map, step));
+			}
+		}
+		else if (command == "world") {
+			int seed, chunkSize = 32, budget = 64;
+			ok = bool(words >> seed);
+			if (ok) {
+				words >> chunkSize >> budget;
+				world.reset(new World(seed, chunkSize, budget));
+			}
+		}
+		else if (command == "roam") {
+			int walkers, ticks, radius = 1;
+			ok = bool(words >> walkers >> ticks) && walkers > 0 && ticks > 0;
+			if (ok && !world) {
+				std::cerr << "line " << lineNumber << ": 'roam' needs a world first\n";
+				return 1;
+			}
+			if (ok) {
+				words >> radius;
+				roamWorld(*world, walkers, ticks, std::max(radius, 0));
+			}
+		}
+		else if (!map) {
+			std::cerr << "line " << lineNumber << ": '" << command << "' needs a map first\n";
+			return 1;
+		}
+		else if (command == "generate") {
+			int seed;
+			ok = bool(words >> seed);
+			if (ok) {
+				map->generateMap(seed);
+				if (planner) {
+					planner->reset();
+				}
+				//Paths on the old tiles are searched again, like after a map swap
+				simInput input;
+				input.testPath = true;
+				input.clickDown = clickDown;
+				sim->queueInput(input);
+			}
+		}
+		else if (command == "maps") {
+			int count, firstSeed = 1;
+			ok = bool(words >> count) && count > 0;
+			if (ok) {
+				words >> firstSeed;
+				std::vector<int> seeds(count);
+				for (int i = 0; i < count; ++i) {
+					seeds[i] = firstSeed + i;
+				}
+				sf::Clock clock;
+				std::vector<mapLayout> layouts = MapGenerator::generateMany(sim->workers, seeds, map->tilesPerRow, map->tilesPerCol);
+				float ms = clock.getElapsedTime().asMicroseconds() / 1000.f;
+				size_t roomCount = 0;
+				for (const mapLayout& layout : layouts) {
+					roomCount += layout.rooms.size();
+				}
+				std::cout << count << " maps in " << ms << " ms on " << sim->workers.size() << " threads, "
+					<< roomCount / float(count) << " rooms each\n";
+			}
+		}
+		else if (command == "unit") {
+			std::string side;
+			int x, y;
+			ok = bool(words >> side >> x >> y) && (side == "player" || side == "enemy")
+				&& x >= 0 && y >= 0 && x < map->tilesPerRow && y < map->tilesPerCol;
+			if (ok) {
+				units.push_back(&sim->addUnit(side == "enemy", map->intXYtoN(x, y)));
+			}
+		}
+		else if (command == "crowd") {
+			int count, routeCount = 16;
+			ok = bool(words >> count) && count >= 0;
+			if (ok && !(words >> routeCount)) {
+				routeCount = 16;
+			}
+			ok = ok && routeCount > 0;
+			if (ok) {
+				ok = spawnCrowd(*map, sim->crowd, count, routeCount);
+			}
+		}
+		else if (command == "swarm") {
+			int count;
+			ok = bool(words >> count) && count >= 0;
+			if (ok) {
+				ok = spawnSwarm(*map, sim->crowd, count);
+			}
+		}
+		else if (command == "cooperative") {
+			int window, interval = 0;
+			ok = bool(words >> window) && window >= 0;
+			if (ok && !(words >> interval)) {
+				interval = window / 2;
+			}
+			if (ok) {
+				sim->crowd.planner = NULL;
+				planner.reset(window > 0 ? new CooperativePlanner(*map, window, interval) : NULL);
+				sim->crowd.planner = planner.get();
+			}
+		}
+		else if (command == "solve") {
+			//Replace the swarm's plans with conflict solver paths to their goals, walked one tile per tick
+			ConflictSolver solver(*map);
+			UnitSystem& crowd = sim->crowd;
+			std::vector<int> agents, starts, goals;
+			for (int u = 0; u < crowd.size(); ++u) {
+				if (crowd.goal[u] >= 0) {
+					agents.push_back(u);
+					starts.push_back(crowd.position[u]);
+					goals.push_back(crowd.goal[u]);
+				}
+			}
+			std::vector<std::vector<int>> paths;
+			if (solver.solve(starts, goals, paths)) {
+				crowd.planner = NULL;
+				planner.reset();
+				for (size_t a = 0; a < agents.size(); ++a) {
+					crowd.patrol[agents[a]] = false;
+					crowd.setPath(agents[a], paths[a].data(), paths[a].size());
+				}
+			}
+			std::cout << "solve: " << agents.size() << " agents " << (solver.optimal ? "optimal" : solver.solved ? "by fallback" : "failed")
+				<< ", cost " << solver.sumOfCosts << ", " << solver.treeNodes << " nodes, " << solver.runtime.asMilliseconds() << " ms\n";
+		}
+		else if (command == "mapf") {
+			int maxAgents, agentStep = 0, trials = 10, nodes = 0, ms = 0;
+			ok = bool(words >> maxAgents) && maxAgents > 0;
+			if (ok) {
+				words >> agentStep >> trials >> nodes >> ms;
+				ConflictSolver solver(*map);
+				if (nodes > 0) {
+					solver.maxTreeNodes = nodes;
+				}
+				if (ms > 0) {
+					solver.timeLimit = sf::milliseconds(ms);
+				}
+				benchmarkSolver(*map, solver, maxAgents, agentStep > 0 ? agentStep : std::max(maxAgents / 5, 1), std::max(trials, 1));
+			}
+		}
+		else if (command == "bench") {
+			int pairs = 100, memoryKB = 64;
+			float weight = 1.2f;
+			words >> pairs >> weight >> memoryKB;
+			ok = pairs > 0 && weight >= 1.f && memoryKB >= 4;
+			if (ok) {
+				benchmarkSearches(*map, pairs, weight, memoryKB);
+			}
+		}
+		else if (command == "landmarks") {
+			int count;
+			std::string placement;
+			ok = bool(words >> count) && count > 0;
+			if (ok) {
+				words >> placement;
+				if (!map->landmarks) {
+					map->landmarks.reset(new Landmarks(*map));
+				}
+				//The settings stay for the landmarks built after the next generate
+				Landmarks& landmarks = *map->landmarks;
+				landmarks.count = count;
+				landmarks.placement = placement == "rooms" ? roomLandmarks : farthestLandmarks;
+				landmarks.build(&sim->workers);
+				std::cout << landmarks.landmarkTiles.size() << " landmarks in " << landmarks.buildTime.asMicroseconds() / 1000.f
+					<< " ms, " << landmarks.memoryBytes() / 1024 << " KB\n";
+			}
+		}
+		else if (command == "firstmoves") {
+			std::string action, path;
+			ok = bool(words >> action) && (action == "build" || ((action == "save" || action == "load") && words >> path));
+			if (ok) {
+				if (!map->firstMoves) {
+					map->firstMoves.reset(new FirstMoveTable(*map));
+				}
+				FirstMoveTable& table = *map->firstMoves;
+				if (action == "build") {
+					table.build(&sim->workers);
+				}
+				else if (!(action == "save" ? table.save(path) : table.load(path))) {
+					std::cerr << "line " << lineNumber << ": could not " << action << " '" << path << "'\n";
+					return 1;
+				}
+				std::cout << "first move table: " << table.runCount() << " runs, " << table.memoryBytes() / 1024 << " KB, "
+					<< table.buildTime.asMicroseconds() / 1000.f << " ms to " << (action == "load" ? "load" : "build") << "\n";
+			}
+		}
+		else if (command == "hierarchy") {
+			int witnessLimit = 64;
+			words >> witnessLimit;
+			ok = witnessLimit > 0;
+			if (ok) {
+				if (!map->hierarchy) {
+					map->hierarchy.reset(new ContractionHierarchy(*map));
+				}
+				ContractionHierarchy& hierarchy = *map->hierarchy;
+				hierarchy.witnessLimit = witnessLimit;
+				hierarchy.build(&sim->workers);
+				std::cout << "contraction hierarchy: " << hierarchy.nodeTiles.size() << " nodes, " << hierarchy.edgeCount() << " edges, "
+					<< hierarchy.shortcutCount() << " shortcuts, " << hierarchy.memoryBytes() / 1024 << " KB, "
+					<< hierarchy.buildTime.asMicroseconds() / 1000.f << " ms to build\n";
+			}
+		}
+		else if (command == "sight") {
+			int queries = 1000, radius = 10;
+			words >> queries >> radius;
+			ok = queries > 0 && radius > 0;
+			if (ok) {
+				benchmarkSight(*map, queries, radius);
+			}
+		}
+		else if (command == "path") {
+			int seeker, target;
+			ok = bool(words >> seeker >> target) && seeker >= 0 && target >= 0
+				&& seeker < int(units.size()) && target < int(units.size());
+			if (ok) {
+				sim->pathSeeker = units[seeker];
+				sim->pathTarget = units[target];
+				simInput input;
+				input.testPath = true;
+				input.clickDown = clickDown;
+				sim->queueInput(input);
+			}
+		}
+		else if (command == "walk") {
+			int unit, x, y;
+			ok = bool(words >> unit >> x >> y) && unit >= 0 && unit < int(units.size())
+				&& x >= 0 && y >= 0 && x < map->tilesPerRow && y < map->tilesPerCol;
+			if (ok) {
+				units[unit]->walkTo(map->intXYtoN(x, y));
+			}
+		}
+		else if (command == "speed") {
+			int unit;
+			float tilesPerTick;
+			ok = bool(words >> unit >> tilesPerTick) && unit >= 0 && unit < int(units.size()) && tilesPerTick >= 0.f;
+			if (ok) {
+				units[unit]->speed = tilesPerTick;
+			}
+		}
+		else if (command == "hunt") {
+			int unit;
+			float radius;
+			ok = bool(words >> unit >> radius) && unit >= 0 && unit < int(units.size()) && radius >= 0.f;
+			if (ok) {
+				units[unit]->sightRadius = radius;
+			}
+		}
+		else if (command == "click" || command == "release") {
+			int x, y;
+			ok = bool(words >> x >> y) && x >= 0 && y >= 0 && x < map->tilesPerRow && y < map->tilesPerCol;
+			if (ok) {
+				simInput input;
+				clickDown = command == "click";
+				input.newClick = clickDown;
+				input.endClick = !clickDown;
+				input.clickDown = clickDown;
+				input.mousePos = map->intXYtoN(x, y);
+				sim->queueInput(input);
+			}
+		}
+		else if (command == "rate") {
+			float hz;
+			ok = bool(words >> hz) && hz >= 0.f;
+			if (ok) {
+				step = hz > 0.f ? sf::seconds(1.f / hz) : sf::Time::Zero;
+				sim->step = step;
+			}
+		}
+		else if (command == "ticks") {
+			int count;
+			ok = bool(words >> count) && count >= 0;
+			if (ok) {
+				//Swarm units are checked for sharing a tile after every tick, which is what the planner should prevent
+				const UnitSystem& crowd = sim->crowd;
+				bool swarm = std::count_if(crowd.goal.begin(), crowd.goal.end(), [](int g) { return g >= 0; }) > 0;
+				std::vector<int> tileStamp(swarm ? map->tileCount : 0, -1);
+				int collisions = 0;
+				sf::Clock clock;
+				sf::Time nextTick;
+				for (int i = 0; i < count; ++i) {
+					if (step > sf::Time::Zero) {
+						//Fixed rate: wait for each tick's turn, but never sleep to make up for a slow tick
+						sf::Time now = clock.getElapsedTime();
+						if (now < nextTick) {
+							sf::sleep(nextTick - now);
+						}
+						nextTick += step;
+					}
+					sim->tick();
+					if (swarm) {
+						for (int u = 0; u < crowd.size(); ++u) {
+							if (crowd.goal[u] < 0)
+								continue;
+							if (tileStamp[crowd.position[u]] == i) {
+								++collisions;
+							}
+							tileStamp[crowd.position[u]] = i;
+						}
+					}
+				}
+				sf::Time elapsed = clock.getElapsedTime();
+				totalTicks += count;
+				totalTime += elapsed;
+				simSnapshot snapshot = sim->getSnapshot();
+				std::cout << count << " ticks in " << elapsed.asMilliseconds() << " ms, "
+					<< (elapsed > sf::Time::Zero ? count / elapsed.asSeconds() : 0.f) << " ticks/s, path "
+					<< snapshot.path.size() << " tiles\n";
+				if (swarm) {
+					int planned = 0, arrived = 0;
+					for (int u = 0; u < crowd.size(); ++u) {
+						if (crowd.goal[u] >= 0) {
+							++planned;
+							arrived += crowd.position[u] == crowd.goal[u];
+						}
+					}
+					std::cout << "  swarm: " << arrived << "/" << planned << " arrived, " << collisions << " shared tiles";
+					if (planner) {
+						std::cout << ", last plan " << planner->expansions << " expansions, " << planner->failedAgents << " agents waiting";
+					}
+					std::cout << "\n";
+				}
+			}
+		}
+		else {
+			std::cerr << "line " << lineNumber << ": unknown command '" << command << "'\n";
+			return 1;
+		}
+
+		if (!ok) {
+			std::cerr << "line " << lineNumber << ": bad arguments for '" << command << "'\n";
+			return 1;
+		}
+	}
+
+	std::cout << totalTicks << " ticks in total, "
+		<< (totalTime > sf::Time::Zero ? totalTicks / totalTime.asSeconds() : 0.f) << " ticks/s\n";
+	return 0;
+}
+
+int runHeadless(const std::string& scriptPath) {
+	if (scriptPath.empty()) {
+		return runScript(std::cin);
+	}
+	std::ifstream file(scriptPath);
+	if (!file) {
+		std::cerr << "Can't open script " << scriptPath << "\n";
+		return 1;
+	}
+	return runScript(file);
+}
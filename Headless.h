@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+
+//Runs the simulation without a window, driven by a script of commands instead of the mouse and keyboard.
+//Reads the script from scriptPath, or from standard input when it's empty, and prints ticks per second
+//
+//One command per line, # starts a comment:
+//  map W H              Make a map W tiles wide and H tiles high, units are removed. Both need to be at least
+//                       MapGenerator::smallestSide, 4 with the default generator parameters
+//  world SEED [CHUNK] [BUDGET]  Make an unbounded world of CHUNK x CHUNK tile chunks (32 by default), keeping at most
+//                       BUDGET chunks loaded (64 by default). Doesn't need a map
+//  roam N TICKS [R]     N walkers cross the world from chunk to chunk for TICKS ticks, keeping the chunks within R
+//                       (1 by default) of each loaded, and print the most chunks that were loaded at once
+//  generate SEED        Generate rooms and halls with this seed
+//  maps N [SEED]        Generate N maps the size of this one at once on the worker threads, with seeds SEED, SEED + 1 ...
+//                       (1 by default), and print how long it took. The current map is left as it is
+//  unit player|enemy X Y  Add a unit on tile X Y, units are numbered from 0 in the order they're added
+//  crowd N [ROUTES]     Add N crowd units walking back and forth along ROUTES random paths, 16 by default
+//  swarm N              Add N crowd units that go from one random tile to another, moved only by the planner
+//  cooperative W [I]    Plan the swarm together W steps ahead, again every I ticks (W / 2 by default), 0 stops planning
+//  solve                Give the swarm collision free paths from the conflict solver, replacing the planner
+//  mapf MAX [STEP] [TRIALS] [NODES] [MS]  Benchmark the conflict solver for STEP, 2 STEP ... MAX agents with the given budget
+//  bench [PAIRS] [WEIGHT] [MEMORY]  Compare the path search modes on PAIRS random tile pairs, 100 by default.
+//                       WEIGHT is the suboptimality the weighted and focal modes may use, 1.2 by default.
+//                       The memory-bounded mode runs in MEMORY KB, 64 by default, and again in each quarter of that
+//                       down to 4 KB. The ratio columns compare each path's length with the shortest grid path
+//  landmarks K [rooms]  Measure K landmarks for landmark searches, placed in rooms or else as far apart as possible,
+//                       and print the time and memory it took
+//  firstmoves build|save FILE|load FILE  Build the first move table for the map, or save or load it, and print its size.
+//                       Loading fails unless the file was saved for the same tiles
+//  hierarchy [WITNESS]  Build the contraction hierarchy for the map and print its size. WITNESS is how many nodes a
+//                       search for a way around a contracted node settles, 64 by default; more gives fewer shortcuts
+//  sight [N] [RADIUS]   Time N sight lines, batches and fields of view of RADIUS tiles, 1000 and 10 by default
+//  path SEEKER TARGET   Make the seeker walk to the target unit, following it as it moves
+//  walk UNIT X Y        Make a unit walk to tile X Y
+//  speed UNIT S         Set how many tiles a unit walks per tick
+//  hunt UNIT R          Make a unit go after the closest unit of the other side within R tiles
+//  click X Y            Press the mouse on tile X Y
+//  release X Y          Release the mouse on tile X Y, dropping a selected unit there
+//  rate HZ              Ticks per second for the ticks that follow, 0 runs them as fast as possible
+//  ticks N              Run N ticks
+int runHeadless(const std::string& scriptPath);
@@ -0,0 +1,140 @@
+#include "stdafx.h"
+#include "Landmarks.h"
+#include "GridMoves.h"
+#include <cmath>
+#include <limits>
+
+const std::uint16_t Landmarks::unreachable;
+const std::uint16_t Landmarks::farthest;
+
+Landmarks::Landmarks(Map& mref) {
+	mapref = &mref;
+}
+
+void Landmarks::build(ThreadPool* pool) {
+	sf::Clock clock;
+	landmarkTiles.clear();
+	distances.clear();
+	stride = 0;
+	builtVersion = mapref->mapVersion;
+	int tileCount = mapref->tileCount;
+	int anyGround = -1;
+	for (int i = 0; i < tileCount && anyGround < 0; ++i) {
+		if (mapref->tiles[i] == ground) {
+			anyGround = i;
+		}
+	}
+	if (anyGround < 0 || count <= 0) {
+		buildTime = clock.getElapsedTime();
+		return;
+	}
+	if (placement == roomLandmarks) {
+		chooseRooms();
+	}
+	bool byRooms = !landmarkTiles.empty();
+	std::vector<float> measured;
+	if (!byRooms) {
+		//The tile farthest from anywhere is on the edge of its part of the map
+		measureDistances(*mapref, anyGround, measured);
+		landmarkTiles.push_back(farthestTile(measured));
+	}
+	measureDistances(*mapref, landmarkTiles[0], measured);
+	//Within one part of the map no landmark is further from a tile than twice the longest distance from the first,
+	//so that picks the finest steps that still fit 16 bits
+	float longest = 0.f;
+	for (float d : measured) {
+		if (d != std::numeric_limits<float>::infinity()) {
+			longest = std::max(longest, d);
+		}
+	}
+	scale = std::min(float(finestScale), farthest / std::max(2.f * longest, 1.f));
+	stride = byRooms ? int(landmarkTiles.size()) : count;
+	distances.assign(size_t(tileCount) * stride, unreachable);
+	store(0, measured);
+	if (byRooms) {
+		//Rooms are chosen up front, so the landmarks can be measured at the same time
+		std::function<void(int)> measureRoom = [this](int i) {
+			std::vector<float> own;
+			measureDistances(*mapref, landmarkTiles[i + 1], own);
+			store(i + 1, own);
+		};
+		if (pool != NULL) {
+			pool->parallelFor(stride - 1, measureRoom);
+		}
+		else {
+			for (int i = 0; i < stride - 1; ++i) {
+				measureRoom(i);
+			}
+		}
+	}
+	else {
+		//Each landmark goes to the tile furthest from all the ones before it
+		std::vector<float> nearest = measured;
+		for (int i = 1; i < stride; ++i) {
+			int next = farthestTile(nearest);
+			landmarkTiles.push_back(next);
+			measureDistances(*mapref, next, measured);
+			store(i, measured);
+			for (int tile = 0; tile < tileCount; ++tile) {
+				nearest[tile] = std::min(nearest[tile], measured[tile]);
+			}
+		}
+	}
+	buildTime = clock.getElapsedTime();
+}
+
+size_t Landmarks::memoryBytes() const {
+	return distances.size() * sizeof(std::uint16_t) + landmarkTiles.size() * sizeof(int);
+}
+
+void Landmarks::store(int landmark, const std::vector<float>& measured) {
+	for (int tile = 0; tile < mapref->tileCount; ++tile) {
+		float d = measured[tile];
+		distances[size_t(tile) * stride + landmark] = d == std::numeric_limits<float>::infinity()
+			? unreachable : std::uint16_t(std::min(d * scale, float(farthest)));
+	}
+}
+
+int Landmarks::farthestTile(const std::vector<float>& measured) const {
+	int best = -1;
+	for (int tile = 0; tile < mapref->tileCount; ++tile) {
+		if (measured[tile] != std::numeric_limits<float>::infinity() && (best < 0 || measured[tile] > measured[best])) {
+			best = tile;
+		}
+	}
+	return best;
+}
+
+void Landmarks::chooseRooms() {
+	//Landmarks work best behind the tiles they help with, so take rooms at even turns around the middle of the map
+	//and the room tile furthest out in each
+	const std::vector<room>& rooms = mapref->rooms;
+	if (int(rooms.size()) < count)
+		return;
+	float middleX = mapref->tilesPerRow / 2.f;
+	float middleY = mapref->tilesPerCol / 2.f;
+	std::vector<std::pair<float, int>> byAngle;
+	for (size_t i = 0; i < rooms.size(); ++i) {
+		const room& r = rooms[i];
+		byAngle.push_back(std::make_pair(std::atan2(r.position.y + r.size.y / 2.f - middleY, r.position.x + r.size.x / 2.f - middleX), int(i)));
+	}
+	std::sort(byAngle.begin(), byAngle.end());
+	for (int i = 0; i < count; ++i) {
+		const room& r = rooms[byAngle[i * rooms.size() / count].second];
+		int best = -1;
+		float bestDistance = -1.f;
+		for (int y = r.position.y; y < r.position.y + r.size.y; ++y) {
+			for (int x = r.position.x; x < r.position.x + r.size.x; ++x) {
+				int tile = mapref->intXYtoN(x, y);
+				float d = (x - middleX) * (x - middleX) + (y - middleY) * (y - middleY);
+				if (mapref->tiles[tile] == ground && d > bestDistance) {
+					best = tile;
+					bestDistance = d;
+				}
+			}
+		}
+		if (best >= 0) {
+			landmarkTiles.push_back(best);
+		}
+	}
+}
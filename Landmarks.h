@@ -0,0 +1,57 @@
+#pragma once
+#include "Map.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+//How Landmarks chooses its tiles
+enum landmarkPlacement {
+	farthestLandmarks, //Each landmark as far along the ground as possible from the ones before it
+	roomLandmarks //The outermost tile of rooms spread around the map, farthestLandmarks when there are too few rooms
+};
+
+//Landmark heuristic (ALT). The true distances from a few landmark tiles bound the distance between any two tiles from
+//below by the triangle inequality, which is far tighter than octile distance where walls make paths wind.
+//Distances are kept in 16 bits, the landmarks of a tile next to each other
+class Landmarks {
+public:
+	Map* mapref;
+	int count = 8; //Landmarks the next build chooses
+	landmarkPlacement placement = farthestLandmarks;
+
+	std::vector<int> landmarkTiles;
+	int builtVersion = -1; //Map::mapVersion of the layout the distances were measured on
+	sf::Time buildTime;
+
+	Landmarks(Map& mref);
+	//Choose the landmarks and measure every tile's distance to them. Rooms placement measures on the pool when given one
+	void build(ThreadPool* pool = NULL);
+	bool current() const { return builtVersion == mapref->mapVersion && int(distances.size()) == mapref->tileCount * stride; }
+	size_t memoryBytes() const;
+	//Lower bound on the length of a path between two tiles, 0 when no landmark tells more
+	float estimate(int tile, int goal) const {
+		const std::uint16_t* from = &distances[tile * stride];
+		const std::uint16_t* to = &distances[goal * stride];
+		int widest = 0;
+		for (int i = 0; i < stride; ++i) {
+			if (from[i] != unreachable && to[i] != unreachable) {
+				widest = std::max(widest, std::abs(int(from[i]) - int(to[i])));
+			}
+		}
+		//Rounding down can make two stored distances one step further apart than the real ones
+		return widest > 1 ? (widest - 1) / scale : 0.f;
+	}
+
+private:
+	static const std::uint16_t unreachable = 0xFFFF;
+	static const std::uint16_t farthest = 0xFFFE; //Longer distances are stored as this, which keeps the bound admissible
+	static const int finestScale = 32; //Steps per tile on maps small enough for them
+	std::vector<std::uint16_t> distances; //stride entries per tile, in steps of 1 / scale tiles
+	int stride = 0;
+	float scale = 1.f;
+
+	void store(int landmark, const std::vector<float>& measured);
+	int farthestTile(const std::vector<float>& measured) const;
+	void chooseRooms();
+};
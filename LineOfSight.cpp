@@ -0,0 +1,145 @@
+#include "stdafx.h"
+#include "LineOfSight.h"
+#include <cstdlib>
+#include <algorithm>
+
+bool lineOfSight(const Map& map, int from, int to) {
+	const tiletype* tiles = map.tiles.data();
+	int w = map.tilesPerRow;
+	int x = from % w;
+	int y = from / w;
+	int dx = to % w - x;
+	int dy = to / w - y;
+	int nx = std::abs(dx);
+	int ny = std::abs(dy);
+	int sx = dx > 0 ? 1 : -1;
+	int sy = dy > 0 ? 1 : -1;
+	if (tiles[from] != ground)
+		return false;
+	//Walk tile by tile, comparing where the line leaves the current tile sideways and vertically, in whole numbers
+	for (int ix = 0, iy = 0; ix < nx || iy < ny;) {
+		int decision = (1 + 2 * ix) * ny - (1 + 2 * iy) * nx;
+		if (decision == 0) {
+			if (tiles[x + sx + y * w] != ground || tiles[x + (y + sy) * w] != ground)
+				return false;
+			x += sx;
+			y += sy;
+			++ix;
+			++iy;
+		}
+		else if (decision < 0) {
+			x += sx;
+			++ix;
+		}
+		else {
+			y += sy;
+			++iy;
+		}
+		if (tiles[x + y * w] != ground)
+			return false;
+	}
+	return true;
+}
+
+int lineOfSightMany(const Map& map, int origin, const int* targets, int count, uint8_t* visible, float range) {
+	int w = map.tilesPerRow;
+	int ox = origin % w;
+	int oy = origin / w;
+	float rangeSquared = range * range;
+	bool originClear = map.tiles[origin] == ground;
+	int seen = 0;
+	for (int i = 0; i < count; ++i) {
+		int dx = targets[i] % w - ox;
+		int dy = targets[i] / w - oy;
+		//Range first, since it's far cheaper than walking the line
+		visible[i] = originClear && (range <= 0.f || float(dx * dx + dy * dy) <= rangeSquared) && lineOfSight(map, origin, targets[i]);
+		seen += visible[i];
+	}
+	return seen;
+}
+
+FieldOfView::FieldOfView(const Map& mref) {
+	mapref = &mref;
+}
+
+void FieldOfView::compute(int from, int sightRadius) {
+	if (int(seenStamp.size()) != mapref->tileCount) {
+		seenStamp.assign(mapref->tileCount, 0);
+		visibleTiles.reserve(mapref->tileCount);
+		stamp = 0;
+	}
+	if (++stamp == 0) {
+		std::fill(seenStamp.begin(), seenStamp.end(), 0);
+		stamp = 1;
+	}
+	visibleTiles.clear();
+	origin = from;
+	radius = sightRadius;
+	if (from < 0 || from >= mapref->tileCount)
+		return;
+	see(from % mapref->tilesPerRow, from / mapref->tilesPerRow);
+	//The eight octants, as the ways row and column steps turn into x and y
+	static const int turns[8][4] = {
+		{ 1, 0, 0, 1 }, { 0, 1, 1, 0 }, { 0, -1, 1, 0 }, { -1, 0, 0, 1 },
+		{ -1, 0, 0, -1 }, { 0, -1, -1, 0 }, { 0, 1, -1, 0 }, { 1, 0, 0, -1 }
+	};
+	for (int octant = 0; octant < 8; ++octant) {
+		castLight(1, 1.f, 0.f, turns[octant][0], turns[octant][1], turns[octant][2], turns[octant][3]);
+	}
+}
+
+void FieldOfView::see(int x, int y) {
+	int tile = x + y * mapref->tilesPerRow;
+	if (seenStamp[tile] != stamp) {
+		seenStamp[tile] = stamp;
+		visibleTiles.push_back(tile);
+	}
+}
+
+bool FieldOfView::opaque(int x, int y) const {
+	return x < 0 || y < 0 || x >= mapref->tilesPerRow || y >= mapref->tilesPerCol || mapref->tiles[x + y * mapref->tilesPerRow] != ground;
+}
+
+void FieldOfView::castLight(int row, float startSlope, float endSlope, int xx, int xy, int yx, int yy) {
+	//Scan rows moving away from the origin, between two slopes. A run of walls narrows the slopes for the rows after it,
+	//and the part before the run is scanned on its own by a recursive call
+	if (startSlope < endSlope)
+		return;
+	int ox = origin % mapref->tilesPerRow;
+	int oy = origin / mapref->tilesPerRow;
+	int radiusSquared = radius * radius;
+	float nextStart = startSlope;
+	for (int distance = row; distance <= radius; ++distance) {
+		bool blocked = false;
+		int dy = -distance;
+		for (int dx = -distance; dx <= 0; ++dx) {
+			float leftSlope = (dx - 0.5f) / (dy + 0.5f);
+			float rightSlope = (dx + 0.5f) / (dy - 0.5f);
+			if (startSlope < rightSlope)
+				continue;
+			if (endSlope > leftSlope)
+				break;
+			int x = ox + dx * xx + dy * xy;
+			int y = oy + dx * yx + dy * yy;
+			bool wallHere = opaque(x, y);
+			if (dx * dx + dy * dy <= radiusSquared && x >= 0 && y >= 0 && x < mapref->tilesPerRow && y < mapref->tilesPerCol) {
+				see(x, y);
+			}
+			if (blocked) {
+				if (wallHere) {
+					nextStart = rightSlope;
+					continue;
+				}
+				blocked = false;
+				startSlope = nextStart;
+			}
+			else if (wallHere && distance < radius) {
+				blocked = true;
+				castLight(distance + 1, startSlope, leftSlope, xx, xy, yx, yy);
+				nextStart = rightSlope;
+			}
+		}
+		if (blocked)
+			break;
+	}
+}
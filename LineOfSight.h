@@ -0,0 +1,32 @@
+#pragma once
+#include "Map.h"
+#include <cstdint>
+
+//Whether a straight line between the centres of two tiles crosses only ground. Every tile the line touches counts,
+//including both tiles beside a corner it passes exactly through, so a unit walking the line never clips a wall
+bool lineOfSight(const Map& map, int from, int to);
+//Test one origin against many targets. visible[i] is set to whether targets[i] is within range tiles and in sight,
+//a range of 0 means any distance. Returns how many are visible
+int lineOfSightMany(const Map& map, int origin, const int* targets, int count, uint8_t* visible, float range = 0.f);
+
+//Every tile an origin can see within a radius, found by shadowcasting each eighth of the circle around it.
+//The arrays are kept between calls, so computing it every tick for every unit allocates nothing once warmed up
+class FieldOfView {
+public:
+	const Map* mapref;
+	int origin = -1;
+	int radius = 0;
+	std::vector<int> visibleTiles; //Tiles seen by the last compute, in no particular order
+
+	FieldOfView(const Map& mref);
+	void compute(int from, int sightRadius);
+	bool visible(int tile) const { return tile >= 0 && tile < int(seenStamp.size()) && seenStamp[tile] == stamp; }
+
+private:
+	std::vector<unsigned> seenStamp;
+	unsigned stamp = 0;
+
+	void see(int x, int y);
+	bool opaque(int x, int y) const;
+	void castLight(int row, float startSlope, float endSlope, int xx, int xy, int yx, int yy);
+};
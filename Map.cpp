@@ -1,16 +1,37 @@
 #include "stdafx.h"
 #include "Map.h"
+#include "MapGenerator.h"
+#include "GridSearch.h"
+#include "Landmarks.h"
+#include "FirstMoveTable.h"
+#include "ContractionHierarchy.h"
+#include <algorithm>
 
-Map::Map(sf::RenderWindow& window, int tilesInRow, int tilesInCol) {
-	mapSize = window.getSize();
+Map::Map(sf::RenderWindow& window, int tilesInRow, int tilesInCol) : Map(window.getSize(), tilesInRow, tilesInCol) {
+	//Fill walls anywhere you want here. A wall down from the top and a short one to its right, left out where the
+	//map is too small for them
+	for (int y = 1; y <= 9; ++y) {
+		if (12 < tilesPerRow - 1 && y < tilesPerCol - 1) {
+			tiles[intXYtoN(12, y)] = wall;
+		}
+	}
+	for (int x = 13; x <= 15; ++x) {
+		if (x < tilesPerRow - 1 && 9 < tilesPerCol - 1) {
+			tiles[intXYtoN(x, 9)] = wall;
+		}
+	}
+}
+
+Map::~Map() {
+}
+
+Map::Map(sf::Vector2u size, int tilesInRow, int tilesInCol) : gridLines(sf::Lines) {
+	mapSize = size;
 	tilesPerRow = tilesInRow;
 	tilesPerCol = tilesInCol;
 	tileCount = tilesPerCol * tilesPerRow;
-	tileW = mapSize.x / tilesPerRow;
-	tileH = mapSize.y / tilesPerCol;
-	tileShape.setSize({ tileW, tileH });
-	tileShape.setOutlineThickness(1.f);
-	tileShape.setOutlineColor(sf::Color::Yellow);
+	tileW = std::max(int(mapSize.x / tilesPerRow), minTileSize);
+	tileH = std::max(int(mapSize.y / tilesPerCol), minTileSize);
 	previewUnitDrop.setRadius(tileW / 2.f);
 	//Generate vector for tiles
 	tiles = std::vector<tiletype>(tileCount);
@@ -23,51 +44,212 @@ Map::Map(sf::RenderWindow& window, int tilesInRow, int tilesInCol) {
 			tiles[i] = ground;
 		}
 	}
-	//Fill walls anywhere you want here
-	tiles[37] = wall;
-	tiles[62] = wall;
-	tiles[87] = wall;
-	tiles[112] = wall;
-	tiles[137] = wall;
-	tiles[162] = wall;
-	tiles[187] = wall;
-	tiles[212] = wall;
-	tiles[237] = wall;
-	tiles[238] = wall;
-	tiles[239] = wall;
-	tiles[240] = wall;
 }
 
-Map::~Map() {
-	for (std::list<room*>::reverse_iterator it = rooms.rbegin(); it != rooms.rend(); ++it)
-		delete* it;
+void Map::drawMap(sf::RenderWindow& window) {
+	//Draw the tiles inside the window's current view from the prebuilt mesh, then the grid lines on top
+	if (!meshReady) {
+		buildMesh();
+	}
+	else if (!dirtyRegions.empty()) {
+		flushDirtyRegions();
+	}
+	//When a tile is down to a couple of pixels, the overview image looks the same and costs one quad
+	const sf::View& view = window.getView();
+	float pixelsPerTile = tileW * window.getSize().x / view.getSize().x;
+	if (pixelsPerTile < 2.f) {
+		if (!overviewTexture) {
+			overviewTexture.reset(new sf::Texture());
+		}
+		if (overviewStale) {
+			overviewTexture->loadFromImage(overviewImage);
+			overviewStale = false;
+		}
+		sf::Sprite overview(*overviewTexture);
+		overview.setScale(tileW * overviewScale, tileH * overviewScale);
+		window.draw(overview);
+		return;
+	}
+	sf::IntRect visible = visibleTiles(view);
+	if (visible.width <= 0 || visible.height <= 0)
+		return;
+	bool useBuffer = tileBuffer && tileBuffer->getVertexCount() > 0;
+	if (visible.width == tilesPerRow) {
+		//Whole rows are visible, so they're one contiguous range
+		int first = intXYtoN(0, visible.top) * 4;
+		int count = visible.height * tilesPerRow * 4;
+		if (useBuffer) {
+			window.draw(*tileBuffer, first, count);
+		}
+		else {
+			//No vertex buffer support, so send the mesh from memory
+			window.draw(&tileVertices[first], count, sf::Quads);
+		}
+	}
+	else {
+		//Draw the visible span of each visible row
+		for (int y = visible.top; y < visible.top + visible.height; ++y) {
+			int first = intXYtoN(visible.left, y) * 4;
+			int count = visible.width * 4;
+			if (useBuffer) {
+				window.draw(*tileBuffer, first, count);
+			}
+			else {
+				window.draw(&tileVertices[first], count, sf::Quads);
+			}
+		}
+	}
+	//Grid lines just turn the screen yellow once tiles get small
+	if (pixelsPerTile >= 4.f) {
+		window.draw(gridLines);
+	}
 }
 
-void Map::drawMap(sf::RenderWindow& window) {
-	//Move a single rectangle across the board to draw each tile
-	sf::Vector2f tilePos;
+sf::IntRect Map::visibleTiles(const sf::View& view) {
+	//Find the tiles that intersect the view, clamped to the map
+	sf::Vector2f topLeft = view.getCenter() - view.getSize() / 2.f;
+	sf::Vector2f bottomRight = view.getCenter() + view.getSize() / 2.f;
+	int left = std::max(0, int(std::floor(topLeft.x / tileW)));
+	int top = std::max(0, int(std::floor(topLeft.y / tileH)));
+	int right = std::min(tilesPerRow, int(std::ceil(bottomRight.x / tileW)));
+	int bottom = std::min(tilesPerCol, int(std::ceil(bottomRight.y / tileH)));
+	return sf::IntRect(left, top, right - left, bottom - top);
+}
+
+void Map::buildMesh() {
+	//Create one quad per tile, coloured by its type
+	tileVertices.resize(tileCount * 4);
 	for (int i = 0; i < tileCount; i++) {
-		tilePos = getTilePos(i);
-		tileShape.setPosition(tilePos);
-		if (tiles[i] == wall) {
-			tileShape.setFillColor(sf::Color::White);
+		float left = (i % tilesPerRow) * tileW;
+		float top = (i / tilesPerRow) * tileH;
+		sf::Vertex* quad = &tileVertices[i * 4];
+		quad[0].position = sf::Vector2f(left, top);
+		quad[1].position = sf::Vector2f(left + tileW, top);
+		quad[2].position = sf::Vector2f(left + tileW, top + tileH);
+		quad[3].position = sf::Vector2f(left, top + tileH);
+		sf::Color color = tileColor(tiles[i]);
+		for (int v = 0; v < 4; ++v)
+			quad[v].color = color;
+	}
+	//Upload to the graphics card when possible, so drawing doesn't resend every tile each frame
+	if (sf::VertexBuffer::isAvailable()) {
+		if (!tileBuffer) {
+			tileBuffer.reset(new sf::VertexBuffer(sf::Quads, sf::VertexBuffer::Static));
 		}
-		else if (tiles[i] == ground) {
-			tileShape.setFillColor(sf::Color::Black);
+		if (tileBuffer->create(tileVertices.size())) {
+			tileBuffer->update(&tileVertices[0]);
 		}
-		else {
-			tileShape.setFillColor(sf::Color::Blue);
+	}
+	//Yellow outline between tiles, as separate line batch
+	gridLines.clear();
+	for (int x = 0; x <= tilesPerRow; ++x) {
+		gridLines.append(sf::Vertex(sf::Vector2f(x * tileW, 0.f), sf::Color::Yellow));
+		gridLines.append(sf::Vertex(sf::Vector2f(x * tileW, tilesPerCol * tileH), sf::Color::Yellow));
+	}
+	for (int y = 0; y <= tilesPerCol; ++y) {
+		gridLines.append(sf::Vertex(sf::Vector2f(0.f, y * tileH), sf::Color::Yellow));
+		gridLines.append(sf::Vertex(sf::Vector2f(tilesPerRow * tileW, y * tileH), sf::Color::Yellow));
+	}
+	//Pick the smallest downsampling that fits in a texture
+	overviewScale = 1;
+	int textureLimit = std::min(int(sf::Texture::getMaximumSize()), int(maxOverviewSize));
+	while ((tilesPerRow + overviewScale - 1) / overviewScale > textureLimit || (tilesPerCol + overviewScale - 1) / overviewScale > textureLimit) {
+		++overviewScale;
+	}
+	overviewImage.create((tilesPerRow + overviewScale - 1) / overviewScale, (tilesPerCol + overviewScale - 1) / overviewScale);
+	buildOverview(sf::IntRect(0, 0, tilesPerRow, tilesPerCol));
+	meshReady = true;
+	dirtyRegions.clear();
+}
+
+void Map::buildOverview(sf::IntRect region) {
+	//Average the tile colours of every overview pixel touching the region
+	int left = region.left / overviewScale;
+	int top = region.top / overviewScale;
+	int right = (region.left + region.width + overviewScale - 1) / overviewScale;
+	int bottom = (region.top + region.height + overviewScale - 1) / overviewScale;
+	for (int py = top; py < bottom; ++py) {
+		for (int px = left; px < right; ++px) {
+			int r = 0, g = 0, b = 0, count = 0;
+			for (int y = py * overviewScale; y < std::min((py + 1) * overviewScale, tilesPerCol); ++y) {
+				for (int x = px * overviewScale; x < std::min((px + 1) * overviewScale, tilesPerRow); ++x) {
+					sf::Color color = tileColor(tiles[intXYtoN(x, y)]);
+					r += color.r;
+					g += color.g;
+					b += color.b;
+					++count;
+				}
+			}
+			overviewImage.setPixel(px, py, sf::Color(r / count, g / count, b / count));
+		}
+	}
+	overviewStale = true;
+}
+
+void Map::markDirty(sf::IntRect region) {
+	//Remember tiles whose colour changed. Nothing to track until the mesh exists, since building it reads every tile
+	if (!meshReady)
+		return;
+	dirtyRegions.push_back(region);
+	if (int(dirtyRegions.size()) > maxDirtyRegions) {
+		//Too many small patches, one big one is cheaper
+		sf::IntRect bounds = dirtyRegions[0];
+		for (const sf::IntRect& r : dirtyRegions) {
+			int right = std::max(bounds.left + bounds.width, r.left + r.width);
+			int bottom = std::max(bounds.top + bounds.height, r.top + r.height);
+			bounds.left = std::min(bounds.left, r.left);
+			bounds.top = std::min(bounds.top, r.top);
+			bounds.width = right - bounds.left;
+			bounds.height = bottom - bounds.top;
+		}
+		dirtyRegions.assign(1, bounds);
+	}
+}
+
+void Map::flushDirtyRegions() {
+	//Recolour the dirty tiles and upload each row of a region as one contiguous range
+	for (const sf::IntRect& r : dirtyRegions) {
+		for (int y = r.top; y < r.top + r.height; ++y) {
+			int first = intXYtoN(r.left, y);
+			for (int i = first; i < first + r.width; ++i) {
+				sf::Color color = tileColor(tiles[i]);
+				for (int v = 0; v < 4; ++v)
+					tileVertices[i * 4 + v].color = color;
+			}
+			if (tileBuffer && tileBuffer->getVertexCount() > 0) {
+				tileBuffer->update(&tileVertices[first * 4], r.width * 4, first * 4);
+			}
 		}
-		window.draw(tileShape);
+		buildOverview(r);
 	}
+	dirtyRegions.clear();
+}
+
+void Map::setTile(int N, tiletype type) {
+	//Change one tile, its quad is recoloured on the next draw
+	if (tiles[N] == type)
+		return;
+	tiles[N] = type;
+	markDirty(sf::IntRect(N % tilesPerRow, N / tilesPerRow, 1, 1));
+	++mapVersion;
+}
+
+sf::Color Map::tileColor(tiletype type) {
+	if (type == wall) {
+		return sf::Color::White;
+	}
+	else if (type == ground) {
+		return sf::Color::Black;
+	}
+	return sf::Color::Blue;
 }
 
 int Map::getTileN(float x, float y) {
-	//Find the index number starting at 0,0 going right then down
-	int tileX, tileY;
-	tileX = int(x / tileW);
-	tileY = int(y / tileH);
-	return tileX + (tileY * tilesPerRow);
+	//Find the index number starting at 0,0 going right then down, or -1 outside the map
+	if (x < 0 || y < 0) {
+		return -1;
+	}
+	return intXYtoN(int(x / tileW), int(y / tileH));
 }
 
 int Map::intXYtoN(int x, int y) {
@@ -81,7 +263,7 @@ sf::Vector2f Map::getTilePos(int N) {
 	//Return position of tile's origin in pixels
 	float posX, posY;
 	posX = (N % tilesPerRow) * tileW;
-	posY = (N / tilesPerCol) * tileH;
+	posY = (N / tilesPerRow) * tileH;
 	return sf::Vector2f(posX, posY);
 }
 
@@ -164,604 +346,99 @@ std::list<int> Map::astar(int start, int end) {
 	return errorList;
 }
 
+std::list<int> Map::findPath(int start, int end, searchMode mode) {
+	//Same result shape as astar: tiles from start to end, or only the start when there's no way
+	if (mode == classicSearch) {
+		return astar(start, end);
+	}
+	if (!searcher) {
+		searcher.reset(new GridSearch(*this));
+	}
+	searchResult found = searcher->find(start, end, mode);
+	if (found.path.empty()) {
+		return std::list<int>{ start };
+	}
+	return std::list<int>(found.path.begin(), found.path.end());
+}
+
+Landmarks& Map::getLandmarks(ThreadPool* pool) {
+	if (!landmarks) {
+		landmarks.reset(new Landmarks(*this));
+	}
+	if (!landmarks->current()) {
+		landmarks->build(pool);
+	}
+	return *landmarks;
+}
+
 void Map::generateMap(int seed) {
 	//Generate a map, and use a new seed if provided
 
-	//Create constants to constrain random number generator
-	const int minSize = 2;
-	const int maxSize = 6;
-	const int sizeMod = maxSize - minSize + 1; //Add one to include max value
-	const int roomDist = 3;
-	const sf::Vector2i posMin = { 1,1 };
-	const sf::Vector2i posMod = { tilesPerRow - minSize - 1, tilesPerCol - minSize - 1 };
 	//Reset random number generator if seed changes
 	if (seed != currentSeed) {
 		rng.seed(seed);
 		currentSeed = seed;
 	}
-	//Reset map to all wall tiles
-	tiles = std::vector<tiletype>(tileCount, wall);
-	for (std::list<room*>::reverse_iterator it = rooms.rbegin(); it != rooms.rend(); ++it)
-		delete *it;
-	rooms.clear();
-	//Create a set of all tiles that cannot have a new room appear
-	std::set<int> noRoomSpawn;
-	std::set<int> tempRoom;
-	//Create vectors for new room location and size
-	sf::Vector2i roomPos;
-	sf::Vector2i roomSize;
-	int failedRooms = 0;
-	//Count rooms to add halls later
-	//Generate rooms until enough failures happened. There's a lot of room for creative cutoffs!
-	while (failedRooms < 15) {
-		//Reset values
-		bool roomFailed = false;
-		tempRoom.clear();
-		//Pick a new random location for a room
-		roomPos.x = rng() % posMod.x + posMin.x;
-		roomPos.y = rng() % posMod.y + posMin.y;
-		//Check if this room is valid by its width
-		roomSize.x = rng() % sizeMod + minSize;
-		while (roomPos.x + roomSize.x > tilesPerRow - 1) {
-			--roomSize.x;
-			if (roomSize.x < minSize) {
-				roomFailed = true;
-				++failedRooms;
-				break;
-			}
-		}
-		if (roomFailed)
-			continue;
-		//Check if this room is valid by its height
-		roomSize.y = rng() % sizeMod + minSize;
-		while (roomPos.y + roomSize.y > tilesPerCol - 1) {
-			--roomSize.y;
-			if (roomSize.y < minSize) {
-				roomFailed = true;
-				++failedRooms;
-				break;
-			}
-		}
-		if (roomFailed)
-			continue;
-		//Iterate through all potential new room tiles
-		for (int y = roomPos.y; y < roomPos.y + roomSize.y; ++y) {
-			for (int x = roomPos.x; x < roomPos.x + roomSize.x; ++x) {
-				if (noRoomSpawn.count(intXYtoN(x, y)) == 0) {
-					//Tile is valid, add to potential new room
-					tempRoom.insert(intXYtoN(x, y));
-				}
-				else {
-					//Tile invalidates this room, room is failed
-					roomFailed = true;
-					++failedRooms;
-					break;
-				}
-			}
-			if (roomFailed) {
-				//If the room failed, no reason to continue iterating through y
-				break;
-			}
-		}
-		//Create room if it wasn't invalidated
-		if (!roomFailed) {
-			rooms.push_back(new room(roomPos, roomSize));
-			for (int tile : tempRoom) {
-				tiles[tile] = ground;
-			}
-			//Iterate through all affected tiles of the new room
-			for (int y = roomPos.y - roomDist; y < roomPos.y + roomSize.y + roomDist; ++y) {
-				for (int x = roomPos.x - roomDist; x < roomPos.x + roomSize.x + roomDist; ++x) {
-					//Prevent all tiles within distance from becoming a new room
-					noRoomSpawn.insert(intXYtoN(x, y));
-				}
-			}
-		}
-	}
-	hallsByPairs();
-	hallsWeightedProbs();
+	MapGenerator generator(tilesPerRow, tilesPerCol);
+	applyLayout(generator.generate(rng));
 }
 
-void Map::hallsByPairs() {
-	//Create halls by finding a pair of doors and drawing a hallway shape based on the doors' facings
-		//Approach:
-		//Pick two doors of two separate rooms
-		//Face doors towards each other using weighted probabilities based on distance (longer distance is higher chance)
-		//Extend halls from doors using its direction. For 3-link halls, pick a random x or y that both links have
-
-	//Convenience parameters
-	typedef std::pair<sf::Vector2i, room*> doorType;
-	enum dir {
-		east,
-		west,
-		south,
-		north
-	};
-	sf::Vector2i paths[4] = {
-		sf::Vector2i(1,0),
-		sf::Vector2i(-1,0),
-		sf::Vector2i(0,1),
-		sf::Vector2i(0,-1)
-	};
-	//Algorithm parameters
-	std::vector<doorType> doors; //Use a vector to make accessing random elements easier
-	const int borderBuffer = 1; //The space between room and outer border needs to be at least 1
-	//Start algorithm
-	if (!rooms.empty()) {
-		int roomCount = rooms.size();
-		int connectedCount = 1;
-		//Determine door locations
-		for (room* r : rooms) {
-			//Find top and bottom doors
-			for (int y = r->position.y; y < r->position.y + r->size.y; y += r->size.y - 1) {
-				for (int x = r->position.x; x < r->position.x + r->size.x; ++x) {
-					//Add door if location is valid
-					if (x > borderBuffer && y > borderBuffer && x < tilesPerRow - borderBuffer - 1 && y < tilesPerCol - borderBuffer - 1) {
-						doorType newDoor = { sf::Vector2i(x,y), r };
-						doors.push_back(newDoor);
-					}
-				}
-			}
-			//Find left and right doors (don't include tiles from top and bottom doors)
-			for (int x = r->position.x; x < r->position.x + r->size.x; x += r->size.x - 1) {
-				for (int y = r->position.y + 1; y < r->position.y + r->size.y - 1; ++y) {
-					//Add door if location is valid
-					if (x > borderBuffer && y > borderBuffer && x < tilesPerRow - borderBuffer - 1 && y < tilesPerCol - borderBuffer - 1) {
-						doorType newDoor = { sf::Vector2i(x,y), r };
-						doors.push_back(newDoor);
-					}
-				}
-			}
-		}
-		int doorCount;
-
-		doorType currentDoor;
-		sf::Vector2i currentPos;
-		room* currentRoom;
-		dir currentDir;  //Direction: 0 +x, 1 -x, 2 +y, 3 -y
-
-		doorType targetDoor;
-		sf::Vector2i targetPos;
-		room* targetRoom = NULL;
-		dir targetDir;  //Direction: 0 +x, 1 -x, 2 +y, 3 -y
-
-		std::set<int> tempHall; //Use a set since only the integer values are used for setting ground tiles
-
-		//Iterate until all rooms are connected
-		while (connectedCount < roomCount) {
-			//Choose a random door
-			doorCount = doors.size();
-			//If there are no more doors, end the algorithm
-			if (doorCount == 0)
-				break;
-			int doorID = rng() % doorCount;
-			currentDoor = doors[doorID];
-			currentPos = currentDoor.first;
-			currentRoom = currentDoor.second;
-			doors.erase(doors.begin() + doorID);
-			//Choose another random door
-			bool checkingDoor = true;
-			//Use a copy of doors to eliminate doors from same room without removing from main vector
-			std::vector<doorType> testDoors = doors;
-			while (testDoors.size() > 0 && checkingDoor) {
-				doorCount = testDoors.size();
-				doorID = rng() % doorCount;
-				targetDoor = testDoors[doorID];
-				targetPos = targetDoor.first;
-				targetRoom = targetDoor.second;
-				//Check if this door is from the same room
-				if (currentRoom == targetRoom) {
-					testDoors.erase(testDoors.begin() + doorID);
-					continue;
-				}
-				//End loop and remove door from main vector
-				checkingDoor = false;
-				doors.erase(std::find(doors.begin(), doors.end(), targetDoor));
-			}
-			//Clear out hallway set
-			tempHall.clear();
-			//Find directions of doors and build halls
-			sf::Vector2i doorDist = targetPos - currentPos;
-			sf::Vector2i tempPos = currentPos;
-			//Doors are aligned vertically
-			if (doorDist.x == 0) {
-				if (doorDist.y > 0) {
-					currentDir = south;
-				}
-				else {
-					currentDir = north;
-				}
-				//Build hall
-				while (tempPos != targetPos) {
-					tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
-					tempPos += paths[currentDir];
-				}
-			}
-			//Doors are aligned horizontally
-			else if (doorDist.y == 0) {
-				if (doorDist.x > 0) {
-					currentDir = east;
-				}
-				else {
-					currentDir = west;
-				}
-				//Build hall
-				while (tempPos != targetPos) {
-					tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
-					tempPos += paths[currentDir];
-				}
-			}
-			//Doors are not aligned
-			else {
-				//Set current door's direction
-				int dirMod = std::abs(doorDist.x) + std::abs(doorDist.y);
-				int curDir = rng() % dirMod;
-				if (curDir < std::abs(doorDist.x)) {
-					//Door faces horizontally
-					if (doorDist.x > 0) {
-						currentDir = east;
-					}
-					else {
-						currentDir = west;
-					}
-				}
-				else {
-					//Door faces vertically
-					if (doorDist.y > 0) {
-						currentDir = south;
-					}
-					else {
-						currentDir = north;
-					}
-				}
-				//Set target door's direction
-				int tarDir = rng() % dirMod;
-				if (tarDir < std::abs(doorDist.x)) {
-					//Door faces horizontally
-					if (doorDist.x > 0) {
-						targetDir = west;
-					}
-					else {
-						targetDir = east;
-					}
-				}
-				else {
-					//Door faces vertically
-					if (doorDist.y > 0) {
-						targetDir = north;
-					}
-					else {
-						targetDir = south;
-					}
-				}
-				//Check if hall uses 3 links, choose the connecting link
-				if (currentDir + targetDir == 1) {
-					//Horizontal doors, vertical link
-					int linkMod = std::abs(doorDist.x);
-					int linkDist = rng() % linkMod;
-					//Link 1
-					for (int x = 0; x < linkDist; ++x) {
-						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
-						tempPos += paths[currentDir];
-					}
-					//Link 2
-					dir link2Dir;
-					if (doorDist.y > 0) {
-						link2Dir = south;
-					}
-					else {
-						link2Dir = north;
-					}
-					for (int y = 0; y < std::abs(doorDist.y); ++y) {
-						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
-						tempPos += paths[link2Dir];
-					}
-					//Link 3
-					for (int x = 0; x < linkMod - linkDist; ++x) {
-						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
-						tempPos += paths[currentDir];
-					}
-				}
-				else if (currentDir + targetDir == 5) {
-					//Vertical doors, horizontal link
-					int linkMod = std::abs(doorDist.y);
-					int linkDist = rng() % linkMod;
-					//Link 1
-					for (int y = 0; y < linkDist; ++y) {
-						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
-						tempPos += paths[currentDir];
-					}
-					//Link 2
-					dir link2Dir;
-					if (doorDist.x > 0) {
-						link2Dir = east;
-					}
-					else {
-						link2Dir = west;
-					}
-					for (int x = 0; x < std::abs(doorDist.x); ++x) {
-						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
-						tempPos += paths[link2Dir];
-					}
-					//Link 3
-					for (int y = 0; y < linkMod - linkDist; ++y) {
-						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
-						tempPos += paths[currentDir];
-					}
-				}
-				else {
-					//Hall has 2 links (L shaped)
-					int link1Dist;
-					int link2Dist;
-					if (currentDir == east || currentDir == west) {
-						//Traveling horizontally first from current position
-						link1Dist = std::abs(doorDist.x);
-						link2Dist = std::abs(doorDist.y);
-					}
-					else {
-						//Traveling vertically first from current position
-						link1Dist = std::abs(doorDist.y);
-						link2Dist = std::abs(doorDist.x);
-					}
-					//Link 1
-					for (int i = 0; i <= link1Dist; ++i) {
-						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
-						tempPos += paths[currentDir];
-					}
-					//Link 2
-					tempPos = targetPos;
-					for (int i = 0; i < link2Dist; ++i) {
-						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
-						tempPos += paths[targetDir];
-					}
-				}
-			}
-			//Make temp hall tiles into ground tiles
-			for (int tile : tempHall) {
-				tiles[tile] = ground;
-			}
-			//Add connected rooms to each other's lists
-			for (room* r : targetRoom->connectedRooms) {
-				currentRoom->connectedRooms.insert(r);
-			}
-			targetRoom->connectedRooms = currentRoom->connectedRooms;
-			//Set connectedCount to this size, if it's bigger
-			int connected = currentRoom->connectedRooms.size();
-			if (connected > connectedCount) {
-				connectedCount = connected;
-			}
-		}
+void Map::generateMapAsync(int seed) {
+	//Generate a map on a worker thread into a back buffer. It's installed by swapPendingMap
+	//Only one map is built at a time, extra requests while one is in flight are dropped
+	if (pendingMap.valid())
+		return;
+	if (seed != currentSeed) {
+		rng.seed(seed);
+		currentSeed = seed;
 	}
+	//The worker gets copies of everything it needs, so the map can keep being drawn and searched meanwhile
+	int tilesInRow = tilesPerRow;
+	int tilesInCol = tilesPerCol;
+	std::minstd_rand random = rng;
+	pendingMap = std::async(std::launch::async, [tilesInRow, tilesInCol, random]() mutable {
+		MapGenerator generator(tilesInRow, tilesInCol);
+		mapLayout layout = generator.generate(random);
+		return std::make_pair(std::move(layout), random);
+	});
 }
 
-void Map::hallsWeightedProbs() {
-	//Create halls in steps by weighting probabilities based on the other rooms
-		//Approach:
-		//Extend a door based on a Markov chain, probabilities based on distance to other rooms
-		//Treat rooms as masses with a center of gravity, use x and y component vectors (with 0,0 as the current tile)
-		//Ground tiles and doors of origin room should have negative gravity (the goal is to move away from this!)
-		//Border tiles also have fixed negative gravity. Traveled tiles and their adjacent tiles are 0 probability
-		//No need to normalize totals, since rng produces a big result. Use a modulus of sum of 4 path probabilities
-		//Consider clamping negatives to 0, or add to all 4 paths such that the lowest is 0
-		//Cornered paths are canceled, start a new search
+bool Map::swapPendingMap() {
+	//Call between frames. Installs the map from generateMapAsync if it's done, without ever waiting on it
+	if (!pendingMap.valid() || pendingMap.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return false;
+	std::pair<mapLayout, std::minstd_rand> finished = pendingMap.get();
+	rng = finished.second;
+	applyLayout(std::move(finished.first));
+	return true;
+}
 
-	//Convenience parameters
-	typedef std::pair<sf::Vector2i, room*> doorType;
-	sf::Vector2i paths[4] = {
-		sf::Vector2i(1,0),
-		sf::Vector2i(-1,0),
-		sf::Vector2i(0,1),
-		sf::Vector2i(0,-1)
-	};
-	struct hall {
-		std::set<int> hallTiles;
-		room* originRoom;
-		hall(std::set<int> tiles, room* roomPtr) : hallTiles(tiles), originRoom(roomPtr) {}
-	};
-	//Algorithm parameters
-	std::vector<doorType> doors;
-	std::list<hall> halls;
-	const int borderBuffer = 1; //The space between room and outer border needs to be at least 1
-	//Start algorithm
-	if (!rooms.empty()) {
-		int roomCount = rooms.size();
-		int connectedCount = 1;
-		//Determine door locations (determined by the bordering wall tiles)
-		for (room* r : rooms) {
-			//Find top and bottom doors
-			for (int y = r->position.y - 1; y <= r->position.y + r->size.y; y += r->size.y + 1) {
-				for (int x = r->position.x; x < r->position.x + r->size.x; ++x) {
-					//Add door if location is valid
-					if (x > borderBuffer && y > borderBuffer && x < tilesPerRow - borderBuffer - 1 && y < tilesPerCol - borderBuffer - 1) {
-						doorType newDoor = { sf::Vector2i(x,y), r };
-						doors.push_back(newDoor);
-						r->doorList.push_back(newDoor.first);
-						//tiles[intXYtoN(x, y)] = water;
-					}
-				}
-			}
-			//Find left and right doors
-			for (int x = r->position.x - 1; x <= r->position.x + r->size.x; x += r->size.x + 1) {
-				for (int y = r->position.y; y < r->position.y + r->size.y; ++y) {
-					//Add door if location is valid
-					if (x > borderBuffer && y > borderBuffer && x < tilesPerRow - borderBuffer - 1 && y < tilesPerCol - borderBuffer - 1) {
-						doorType newDoor = { sf::Vector2i(x,y), r };
-						doors.push_back(newDoor);
-						r->doorList.push_back(newDoor.first);
-						//tiles[intXYtoN(x, y)] = water;
-					}
+void Map::applyLayout(mapLayout&& layout) {
+	//Take over a generated grid and its rooms, the old ones are freed with the layout
+	//Anything derived from the tiles gets rebuilt here
+	//Only the changed span of each row is marked dirty, so the mesh isn't rebuilt for a new map of the same size
+	if (layout.tiles.size() == tiles.size()) {
+		for (int y = 0; y < tilesPerCol; ++y) {
+			int first = -1;
+			int last = -1;
+			for (int x = 0; x < tilesPerRow; ++x) {
+				int i = x + y * tilesPerRow;
+				if (tiles[i] != layout.tiles[i]) {
+					if (first < 0)
+						first = x;
+					last = x;
 				}
 			}
-		}
-		int doorCount;
-		doorType currentDoor;
-		std::set<int> tempHall;
-		float pathProbs[4] = { 0,0,0,0 }; //Direction: 0 +x, 1 -x, 2 +y, 3 -y
-		bool buildingHall;
-		while (connectedCount < roomCount) {
-			//Choose a random door
-			doorCount = doors.size();
-			if (doorCount == 0)
-				break;
-			currentDoor = doors[rng() % doorCount];
-			room* currentRoom = currentDoor.second;
-			//Begin building hallway
-			buildingHall = true;
-			tempHall.clear();
-			sf::Vector2i tempDoor = currentDoor.first; //This is the test location of the hall, as if the door extruded outwards
-			tempHall.insert(intXYtoN(tempDoor.x, tempDoor.y));
-			sf::Vector2f force;
-			int lastDir = 4; //Index for the last direction traveled. Starts at 4 so that first pass doesn't use this
-			while (buildingHall) {
-				//Reset probabilities
-				for (int i = 0; i < 4; ++i)
-					pathProbs[i] = 0;
-				//Find gravity along x and y
-				for (room* r : rooms) {
-					float mass = r->size.x * r->size.y;
-					if (currentDoor.second == r) {
-						//Origin room, so negate mass to move away rapidly
-						mass *= -1;
-					}
-					sf::Vector2f roomCenter = { r->position.x + r->size.x / 2.f, r->position.y + r->size.y / 2.f };
-					sf::Vector2f doorCenter = { tempDoor.x + 0.5f, tempDoor.y + 0.5f };
-					sf::Vector2f distance = roomCenter - doorCenter;
-					float distanceMag = std::sqrtf(std::powf(distance.x, 2.f) + std::powf(distance.y, 2.f));
-					float forceMag = mass / std::powf(distanceMag, 2.f);
-					sf::Vector2f forceDir = distance / distanceMag;
-					force = forceMag * forceDir;
-					//Find force to increase probability of traveling in a direction. Sign of distance chooses which path is increased
-					if (distance.x > 0) {
-						pathProbs[0] += std::copysignf(force.x, mass);
-					}
-					else if (distance.x < 0) {
-						pathProbs[1] += std::copysignf(force.x, mass);
-					}
-					if (distance.y > 0) {
-						pathProbs[2] += std::copysignf(force.y, mass);
-					}
-					else if (distance.y < 0) {
-						pathProbs[3] += std::copysignf(force.y, mass);
-					}
-				}
-				//Set all probabilities to non-negative by subtracting most negative number
-				float offset = *std::min_element(pathProbs, pathProbs + 4);
-				if (offset < 0) {
-					for (int i = 0; i < 4; ++i) {
-						pathProbs[i] -= offset;
-					}
-				}
-				//Impose constraints and add to total for rng modulus
-				int dirMod = 0;
-				sf::Vector2i tempPath;
-				for (int i = 0; i < 4; ++i) {
-					tempPath = tempDoor + paths[i];
-					//Is the path a floor tile of the origin room?
-					if (tempPath > currentRoom->position && tempPath < currentRoom->position + currentRoom->size) {
-						pathProbs[i] = 0;
-						continue;
-					}
-					//Is the path a door of the origin room?
-					if (std::find(currentRoom->doorList.begin(), currentRoom->doorList.end(), tempPath) != currentRoom->doorList.end()) {
-						pathProbs[i] = 0;
-						continue;
-					}
-					//Is the path a border tile?
-					if (tempPath.x == 0 || tempPath.x == tilesPerRow - 1 || tempPath.y == 0 || tempPath.y == tilesPerCol - 1) {
-						pathProbs[i] = 0;
-						continue;
-					}
-					//Is the path on an explored tile?
-					if (tempHall.find(intXYtoN(tempPath.x, tempPath.y)) != tempHall.end()) {
-						pathProbs[i] = 0;
-						continue;
-					}
-					//Add a bonus if this is the same direction as last step
-					if (lastDir == i)
-						pathProbs[i] *= 2.f;
-					//Increase total modulus for the roll. If a number to add is 0, this getting skipped is inconsequential
-					dirMod += int(1000 * pathProbs[i]);
-				}
-				//Roll to check the direction
-				if (dirMod > 0) {
-					int dir = rng() % dirMod;
-					int dirCheck = 0;
-					for (int i = 0; i < 4; ++i) {
-						//Increase the check
-						dirCheck += int(1000 * pathProbs[i]);
-						//The rng rolled more than last check, but lower than this check, so end loop and use new path
-						if (dir < dirCheck) {
-							tempDoor += paths[i];
-							tempHall.insert(intXYtoN(tempDoor.x, tempDoor.y));
-							//Update last direction with this new one
-							lastDir = i;
-							break;
-						}
-					}
-					//Check if this new location is a hall
-					for (std::list<hall>::iterator it = halls.begin(); it != halls.end(); ++it) {
-						hall h = *it;
-						if (h.hallTiles.find(intXYtoN(tempDoor.x, tempDoor.y)) != h.hallTiles.end()) {
-							//Hall connected to hall, end this while loop
-							buildingHall = false;
-							//Add the connecting rooms' set of rooms to each other
-							for (room* r : h.originRoom->connectedRooms) {
-								currentRoom->connectedRooms.insert(r);
-							}
-							h.originRoom->connectedRooms = currentRoom->connectedRooms;
-							//Set connectedCount to this size, if it's bigger
-							int connected = currentRoom->connectedRooms.size();
-							if (connected > connectedCount) {
-								connectedCount = connected;
-							}
-							//Set all tiles in the temporary hall to actual ground tiles
-							for (int t : tempHall) {
-								tiles[t] = ground;
-							}
-							//Add the hall to the list
-							halls.emplace_back(tempHall, currentRoom);
-							//Remove the door from the vector
-							doors.erase(std::find(doors.begin(), doors.end(), currentDoor));
-							break;
-						}
-					}
-					//No reason to check if the location is a door now that the hall is built
-					if (!buildingHall)
-						continue;
-					//Check if this new location is a door of another room
-					for (std::vector<doorType>::iterator it = doors.begin(); it != doors.end(); ++it) {
-						doorType d = *it;
-						if (d.first == tempDoor && d.second != currentRoom) {
-							//Hall complete, end this while loop
-							buildingHall = false;
-							//Add the connecting rooms' set of rooms to each other
-							for (room* r : d.second->connectedRooms) {
-								currentRoom->connectedRooms.insert(r);
-							}
-							d.second->connectedRooms = currentRoom->connectedRooms;
-							//Set connectedCount to this size, if it's bigger
-							int connected = currentRoom->connectedRooms.size();
-							if (connected > connectedCount) {
-								connectedCount = connected;
-							}
-							//Set all tiles in the temporary hall to actual ground tiles
-							for (int t : tempHall) {
-								tiles[t] = ground;
-							}
-							//Add the hall to the list
-							halls.emplace_back(tempHall, currentRoom);
-							//Remove the doors from the vector
-							doors.erase(it);
-							doors.erase(std::find(doors.begin(), doors.end(), currentDoor));
-							break;
-						}
-					}
-				}
-				//If dirMod is 0, then the hallway hit a dead end
-				else {
-					buildingHall = false;
-				}
+			if (first >= 0) {
+				markDirty(sf::IntRect(first, y, last - first + 1, 1));
 			}
 		}
 	}
+	else {
+		meshReady = false;
+	}
+	tiles.swap(layout.tiles);
+	rooms.swap(layout.rooms);
+	doorTiles.swap(layout.doorTiles);
+	++mapVersion;
 }
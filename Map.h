@@ -6,6 +6,8 @@
 #include <map>
 #include <random>
 #include <iostream>
+#include <future>
+#include <memory>
 
 template <typename T>
 bool operator > (const sf::Vector2<T>& lhs, const sf::Vector2<T>& rhs) { return (lhs.x > rhs.x && lhs.y > rhs.y); }
@@ -28,15 +30,53 @@ enum tiletype {
 struct room {
 	sf::Vector2i position = { 0,0 };
 	sf::Vector2i size = { 0,0 };
-	std::set<room*> connectedRooms = { this };
-	std::list<sf::Vector2i> doorList;
+	int firstDoor = 0; //This room's doors are doorTiles[firstDoor] to doorTiles[firstDoor + doorCount - 1]
+	int doorCount = 0;
 	room() {}
 	room(sf::Vector2i pos, sf::Vector2i sz) : position(pos), size(sz) {}
 };
 
+struct genParams {
+	int minRoomSize = 2;
+	int maxRoomSize = 6;
+	int roomDist = 3; //Tiles kept clear around a room before another room can spawn
+	int maxFailedRooms = 15; //Failed room placements before room generation stops
+};
+
+//A generated grid and the rooms on it
+struct mapLayout {
+	int tilesPerRow = 0;
+	int tilesPerCol = 0;
+	std::vector<tiletype> tiles;
+	std::vector<room> rooms;
+	std::vector<sf::Vector2i> doorTiles; //Door ring of every room, grouped by room
+};
+
+//Ways Map::findPath can search
+enum searchMode {
+	classicSearch, //Map::astar
+	astarSearch,
+	thetaSearch,
+	lazyThetaSearch,
+	smoothedSearch, //A* followed by string pulling
+	anytimeSearch, //ARA*, as good a path as GridSearch::anytimeBudget allows
+	weightedSearch, //Weighted A*, at most GridSearch::suboptimality times the shortest path
+	focalSearch, //A* epsilon, the same bound as weightedSearch
+	landmarkSearch, //A* with the landmark heuristic from Map::getLandmarks
+	firstMoveSearch, //Read from Map::firstMoves without searching, astar when there's no table for the current layout
+	hierarchySearch, //Map::hierarchy's query, astar when there's no hierarchy for the current layout
+	fringeSearch,
+	boundedSearch //IDA* in GridSearch::boundedMemory bytes
+};
+
+class GridSearch;
+class Landmarks;
+class FirstMoveTable;
+class ContractionHierarchy;
+class ThreadPool;
+
 class Map {
 public:
-	sf::RectangleShape tileShape;
 	sf::Vector2u mapSize;
 	float tileH, tileW;
 	int tilesPerRow;
@@ -44,7 +84,24 @@ public:
 	int tileCount;
 	std::vector<tiletype> tiles;
 
-	int mousePos;
+	//Tiles are drawn from one mesh, 4 vertices per tile in tile order
+	//Changed tiles are recorded as dirty regions (in tiles) and only those are re-uploaded when drawing
+	std::vector<sf::Vertex> tileVertices;
+	std::unique_ptr<sf::VertexBuffer> tileBuffer; //Graphics resources are made on the first draw, so a Map works without a display
+	sf::VertexArray gridLines;
+	bool meshReady = false;
+	std::vector<sf::IntRect> dirtyRegions;
+	static const int maxDirtyRegions = 1024; //Past this, the regions collapse into their bounding box
+
+	//Downsampled copy of the map, one pixel per overviewScale x overviewScale tiles, drawn when zoomed far out
+	sf::Image overviewImage;
+	std::unique_ptr<sf::Texture> overviewTexture;
+	int overviewScale = 1;
+	bool overviewStale = true;
+	static const int minTileSize = 8; //Big maps keep tiles at least this many pixels wide and use a camera to see the rest
+	static const int maxOverviewSize = 2048;
+
+	int mousePos = -1;
 	bool newClick = false;
 	bool endClick = false;
 	bool clickDown = false;
@@ -53,20 +110,39 @@ public:
 
 	std::minstd_rand rng;
 	int currentSeed = 1;
+	int mapVersion = 0; //Increases every time a new layout is installed or a tile changes, so old paths and tables can be recognised
+	std::future<std::pair<mapLayout, std::minstd_rand>> pendingMap; //Map being built on a worker thread
+	std::unique_ptr<GridSearch> searcher; //Made on the first findPath, and kept so its arrays are reused
+	std::unique_ptr<Landmarks> landmarks;
+	std::unique_ptr<FirstMoveTable> firstMoves; //Only built or loaded when asked, since it takes a search from every tile
+	std::unique_ptr<ContractionHierarchy> hierarchy; //Only built when asked, like firstMoves
 
 
-	std::list<room*> rooms;
+	std::vector<room> rooms;
+	std::vector<sf::Vector2i> doorTiles;
 
 	Map(sf::RenderWindow& window, int tilesInRow, int tilesInCol);
+	Map(sf::Vector2u size, int tilesInRow, int tilesInCol); //Size in pixels the map would be drawn at
 	~Map();
 	void drawMap(sf::RenderWindow& window);
+	void buildMesh();
+	void markDirty(sf::IntRect region);
+	void flushDirtyRegions();
+	void buildOverview(sf::IntRect region);
+	sf::IntRect visibleTiles(const sf::View& view);
+	void setTile(int N, tiletype type);
+	static sf::Color tileColor(tiletype type);
 	int getTileN(float x, float y);
 	int intXYtoN(int x, int y); //{ return x + y * tilesPerRow; }
 	sf::Vector2f getTilePos(int N);
 
 	std::list<int> astar(int start, int end);
+	std::list<int> findPath(int start, int end, searchMode mode);
+	//Landmarks for the current layout, built first if there are none yet or they were measured on an older one
+	Landmarks& getLandmarks(ThreadPool* pool = NULL);
 
 	void generateMap(int seed);
-	void hallsByPairs();
-	void hallsWeightedProbs();
+	void generateMapAsync(int seed);
+	bool swapPendingMap();
+	void applyLayout(mapLayout&& layout);
 };
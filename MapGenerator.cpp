@@ -0,0 +1,663 @@
+#include "stdafx.h"
+#include "MapGenerator.h"
+#include <algorithm>
+#include <bitset>
+
+MapGenerator::MapGenerator(int tilesInRow, int tilesInCol, genParams parameters) {
+	tilesPerRow = tilesInRow;
+	tilesPerCol = tilesInCol;
+	tileCount = tilesPerCol * tilesPerRow;
+	params = parameters;
+}
+
+mapLayout MapGenerator::generate(int seed, int tilesInRow, int tilesInCol, genParams parameters) {
+	//Build a map that depends only on its arguments, so it's safe to call from any thread
+	std::minstd_rand random(seed);
+	MapGenerator generator(tilesInRow, tilesInCol, parameters);
+	return generator.generate(random);
+}
+
+std::vector<mapLayout> MapGenerator::generateMany(ThreadPool& pool, const std::vector<int>& seeds, int tilesInRow, int tilesInCol, genParams parameters) {
+	//Every seed gets its own generator and rng, so the results match generating them one at a time
+	std::vector<mapLayout> layouts(seeds.size());
+	pool.parallelFor(seeds.size(), [&](int i) {
+		layouts[i] = generate(seeds[i], tilesInRow, tilesInCol, parameters);
+	});
+	return layouts;
+}
+
+void MapGenerator::resetConnections() {
+	//Every room starts out knowing only about itself
+	int roomCount = rooms.size();
+	connectedWords = (roomCount + 63) / 64;
+	connectedBits.assign(roomCount * connectedWords, 0);
+	for (int r = 0; r < roomCount; ++r) {
+		connectedBits[r * connectedWords + r / 64] |= std::uint64_t(1) << (r % 64);
+	}
+}
+
+int MapGenerator::connectRooms(int a, int b) {
+	//Merge b's known connections into a, then give b a copy of a's. Other rooms in either group keep their rows
+	//Returns how many rooms a now knows it's connected to
+	std::uint64_t* rowA = &connectedBits[a * connectedWords];
+	std::uint64_t* rowB = &connectedBits[b * connectedWords];
+	int connected = 0;
+	for (int i = 0; i < connectedWords; ++i) {
+		rowA[i] |= rowB[i];
+		rowB[i] = rowA[i];
+		connected += std::bitset<64>(rowA[i]).count();
+	}
+	return connected;
+}
+
+int MapGenerator::intXYtoN(int x, int y) {
+	if (x < 0 || y < 0 || x >= tilesPerRow || y >= tilesPerCol) {
+		return -1;
+	}
+	return x + y * tilesPerRow;
+}
+
+mapLayout MapGenerator::generate(std::minstd_rand& random) {
+	//Generate a map from the given rng, leaving it advanced as if the map was built with it directly
+	rng = random;
+
+	//Create constants to constrain random number generator
+	const int minSize = params.minRoomSize;
+	const int maxSize = params.maxRoomSize;
+	const int sizeMod = maxSize - minSize + 1; //Add one to include max value
+	const int roomDist = params.roomDist;
+	const sf::Vector2i posMin = { 1,1 };
+	const sf::Vector2i posMod = { tilesPerRow - minSize - 1, tilesPerCol - minSize - 1 };
+	//Reset map to all wall tiles
+	tiles = std::vector<tiletype>(tileCount, wall);
+	rooms.clear();
+	doorTiles.clear();
+	//Create a set of all tiles that cannot have a new room appear
+	std::set<int> noRoomSpawn;
+	std::set<int> tempRoom;
+	//Create vectors for new room location and size
+	sf::Vector2i roomPos;
+	sf::Vector2i roomSize;
+	int failedRooms = 0;
+	//Count rooms to add halls later
+	//Generate rooms until enough failures happened. There's a lot of room for creative cutoffs!
+	while (failedRooms < params.maxFailedRooms) {
+		//Reset values
+		bool roomFailed = false;
+		tempRoom.clear();
+		//Pick a new random location for a room
+		roomPos.x = rng() % posMod.x + posMin.x;
+		roomPos.y = rng() % posMod.y + posMin.y;
+		//Check if this room is valid by its width
+		roomSize.x = rng() % sizeMod + minSize;
+		while (roomPos.x + roomSize.x > tilesPerRow - 1) {
+			--roomSize.x;
+			if (roomSize.x < minSize) {
+				roomFailed = true;
+				++failedRooms;
+				break;
+			}
+		}
+		if (roomFailed)
+			continue;
+		//Check if this room is valid by its height
+		roomSize.y = rng() % sizeMod + minSize;
+		while (roomPos.y + roomSize.y > tilesPerCol - 1) {
+			--roomSize.y;
+			if (roomSize.y < minSize) {
+				roomFailed = true;
+				++failedRooms;
+				break;
+			}
+		}
+		if (roomFailed)
+			continue;
+		//Iterate through all potential new room tiles
+		for (int y = roomPos.y; y < roomPos.y + roomSize.y; ++y) {
+			for (int x = roomPos.x; x < roomPos.x + roomSize.x; ++x) {
+				if (noRoomSpawn.count(intXYtoN(x, y)) == 0) {
+					//Tile is valid, add to potential new room
+					tempRoom.insert(intXYtoN(x, y));
+				}
+				else {
+					//Tile invalidates this room, room is failed
+					roomFailed = true;
+					++failedRooms;
+					break;
+				}
+			}
+			if (roomFailed) {
+				//If the room failed, no reason to continue iterating through y
+				break;
+			}
+		}
+		//Create room if it wasn't invalidated
+		if (!roomFailed) {
+			rooms.emplace_back(roomPos, roomSize);
+			for (int tile : tempRoom) {
+				tiles[tile] = ground;
+			}
+			//Iterate through all affected tiles of the new room
+			for (int y = roomPos.y - roomDist; y < roomPos.y + roomSize.y + roomDist; ++y) {
+				for (int x = roomPos.x - roomDist; x < roomPos.x + roomSize.x + roomDist; ++x) {
+					//Prevent all tiles within distance from becoming a new room
+					noRoomSpawn.insert(intXYtoN(x, y));
+				}
+			}
+		}
+	}
+	resetConnections();
+	hallsByPairs();
+	hallsWeightedProbs();
+	//Hand the finished grid and rooms over to the caller
+	random = rng;
+	mapLayout layout;
+	layout.tilesPerRow = tilesPerRow;
+	layout.tilesPerCol = tilesPerCol;
+	layout.tiles.swap(tiles);
+	layout.rooms.swap(rooms);
+	layout.doorTiles.swap(doorTiles);
+	return layout;
+}
+
+void MapGenerator::hallsByPairs() {
+	//Create halls by finding a pair of doors and drawing a hallway shape based on the doors' facings
+		//Approach:
+		//Pick two doors of two separate rooms
+		//Face doors towards each other using weighted probabilities based on distance (longer distance is higher chance)
+		//Extend halls from doors using its direction. For 3-link halls, pick a random x or y that both links have
+
+	//Convenience parameters
+	typedef std::pair<sf::Vector2i, int> doorType; //Door location and index of its room
+	enum dir {
+		east,
+		west,
+		south,
+		north
+	};
+	sf::Vector2i paths[4] = {
+		sf::Vector2i(1,0),
+		sf::Vector2i(-1,0),
+		sf::Vector2i(0,1),
+		sf::Vector2i(0,-1)
+	};
+	//Algorithm parameters
+	std::vector<doorType> doors; //Use a vector to make accessing random elements easier
+	const int borderBuffer = 1; //The space between room and outer border needs to be at least 1
+	//Start algorithm
+	if (!rooms.empty()) {
+		int roomCount = rooms.size();
+		int connectedCount = 1;
+		//Determine door locations
+		for (int r = 0; r < roomCount; ++r) {
+			const room& rm = rooms[r];
+			//Find top and bottom doors
+			for (int y = rm.position.y; y < rm.position.y + rm.size.y; y += rm.size.y - 1) {
+				for (int x = rm.position.x; x < rm.position.x + rm.size.x; ++x) {
+					//Add door if location is valid
+					if (x > borderBuffer && y > borderBuffer && x < tilesPerRow - borderBuffer - 1 && y < tilesPerCol - borderBuffer - 1) {
+						doorType newDoor = { sf::Vector2i(x,y), r };
+						doors.push_back(newDoor);
+					}
+				}
+			}
+			//Find left and right doors (don't include tiles from top and bottom doors)
+			for (int x = rm.position.x; x < rm.position.x + rm.size.x; x += rm.size.x - 1) {
+				for (int y = rm.position.y + 1; y < rm.position.y + rm.size.y - 1; ++y) {
+					//Add door if location is valid
+					if (x > borderBuffer && y > borderBuffer && x < tilesPerRow - borderBuffer - 1 && y < tilesPerCol - borderBuffer - 1) {
+						doorType newDoor = { sf::Vector2i(x,y), r };
+						doors.push_back(newDoor);
+					}
+				}
+			}
+		}
+		int doorCount;
+
+		doorType currentDoor;
+		sf::Vector2i currentPos;
+		int currentRoom;
+		dir currentDir;  //Direction: 0 +x, 1 -x, 2 +y, 3 -y
+
+		doorType targetDoor;
+		sf::Vector2i targetPos;
+		int targetRoom = -1;
+		dir targetDir;  //Direction: 0 +x, 1 -x, 2 +y, 3 -y
+
+		std::set<int> tempHall; //Use a set since only the integer values are used for setting ground tiles
+
+		//Iterate until all rooms are connected
+		while (connectedCount < roomCount) {
+			//Choose a random door
+			doorCount = doors.size();
+			//If there are no more doors, end the algorithm
+			if (doorCount == 0)
+				break;
+			int doorID = rng() % doorCount;
+			currentDoor = doors[doorID];
+			currentPos = currentDoor.first;
+			currentRoom = currentDoor.second;
+			doors.erase(doors.begin() + doorID);
+			//Choose another random door
+			targetRoom = -1;
+			bool checkingDoor = true;
+			//Use a copy of doors to eliminate doors from same room without removing from main vector
+			std::vector<doorType> testDoors = doors;
+			while (testDoors.size() > 0 && checkingDoor) {
+				doorCount = testDoors.size();
+				doorID = rng() % doorCount;
+				targetDoor = testDoors[doorID];
+				targetPos = targetDoor.first;
+				targetRoom = targetDoor.second;
+				//Check if this door is from the same room
+				if (currentRoom == targetRoom) {
+					testDoors.erase(testDoors.begin() + doorID);
+					continue;
+				}
+				//End loop and remove door from main vector
+				checkingDoor = false;
+				doors.erase(std::find(doors.begin(), doors.end(), targetDoor));
+			}
+			//No other room has a door left to connect to, so there's nowhere to build a hall to
+			if (checkingDoor)
+				continue;
+			//Clear out hallway set
+			tempHall.clear();
+			//Find directions of doors and build halls
+			sf::Vector2i doorDist = targetPos - currentPos;
+			sf::Vector2i tempPos = currentPos;
+			//Doors are aligned vertically
+			if (doorDist.x == 0) {
+				if (doorDist.y > 0) {
+					currentDir = south;
+				}
+				else {
+					currentDir = north;
+				}
+				//Build hall
+				while (tempPos != targetPos) {
+					tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
+					tempPos += paths[currentDir];
+				}
+			}
+			//Doors are aligned horizontally
+			else if (doorDist.y == 0) {
+				if (doorDist.x > 0) {
+					currentDir = east;
+				}
+				else {
+					currentDir = west;
+				}
+				//Build hall
+				while (tempPos != targetPos) {
+					tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
+					tempPos += paths[currentDir];
+				}
+			}
+			//Doors are not aligned
+			else {
+				//Set current door's direction
+				int dirMod = std::abs(doorDist.x) + std::abs(doorDist.y);
+				int curDir = rng() % dirMod;
+				if (curDir < std::abs(doorDist.x)) {
+					//Door faces horizontally
+					if (doorDist.x > 0) {
+						currentDir = east;
+					}
+					else {
+						currentDir = west;
+					}
+				}
+				else {
+					//Door faces vertically
+					if (doorDist.y > 0) {
+						currentDir = south;
+					}
+					else {
+						currentDir = north;
+					}
+				}
+				//Set target door's direction
+				int tarDir = rng() % dirMod;
+				if (tarDir < std::abs(doorDist.x)) {
+					//Door faces horizontally
+					if (doorDist.x > 0) {
+						targetDir = west;
+					}
+					else {
+						targetDir = east;
+					}
+				}
+				else {
+					//Door faces vertically
+					if (doorDist.y > 0) {
+						targetDir = north;
+					}
+					else {
+						targetDir = south;
+					}
+				}
+				//Check if hall uses 3 links, choose the connecting link
+				if (currentDir + targetDir == 1) {
+					//Horizontal doors, vertical link
+					int linkMod = std::abs(doorDist.x);
+					int linkDist = rng() % linkMod;
+					//Link 1
+					for (int x = 0; x < linkDist; ++x) {
+						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
+						tempPos += paths[currentDir];
+					}
+					//Link 2
+					dir link2Dir;
+					if (doorDist.y > 0) {
+						link2Dir = south;
+					}
+					else {
+						link2Dir = north;
+					}
+					for (int y = 0; y < std::abs(doorDist.y); ++y) {
+						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
+						tempPos += paths[link2Dir];
+					}
+					//Link 3
+					for (int x = 0; x < linkMod - linkDist; ++x) {
+						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
+						tempPos += paths[currentDir];
+					}
+				}
+				else if (currentDir + targetDir == 5) {
+					//Vertical doors, horizontal link
+					int linkMod = std::abs(doorDist.y);
+					int linkDist = rng() % linkMod;
+					//Link 1
+					for (int y = 0; y < linkDist; ++y) {
+						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
+						tempPos += paths[currentDir];
+					}
+					//Link 2
+					dir link2Dir;
+					if (doorDist.x > 0) {
+						link2Dir = east;
+					}
+					else {
+						link2Dir = west;
+					}
+					for (int x = 0; x < std::abs(doorDist.x); ++x) {
+						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
+						tempPos += paths[link2Dir];
+					}
+					//Link 3
+					for (int y = 0; y < linkMod - linkDist; ++y) {
+						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
+						tempPos += paths[currentDir];
+					}
+				}
+				else {
+					//Hall has 2 links (L shaped)
+					int link1Dist;
+					int link2Dist;
+					if (currentDir == east || currentDir == west) {
+						//Traveling horizontally first from current position
+						link1Dist = std::abs(doorDist.x);
+						link2Dist = std::abs(doorDist.y);
+					}
+					else {
+						//Traveling vertically first from current position
+						link1Dist = std::abs(doorDist.y);
+						link2Dist = std::abs(doorDist.x);
+					}
+					//Link 1
+					for (int i = 0; i <= link1Dist; ++i) {
+						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
+						tempPos += paths[currentDir];
+					}
+					//Link 2
+					tempPos = targetPos;
+					for (int i = 0; i < link2Dist; ++i) {
+						tempHall.insert(intXYtoN(tempPos.x, tempPos.y));
+						tempPos += paths[targetDir];
+					}
+				}
+			}
+			//Make temp hall tiles into ground tiles
+			for (int tile : tempHall) {
+				tiles[tile] = ground;
+			}
+			//Add connected rooms to each other's lists
+			int connected = connectRooms(currentRoom, targetRoom);
+			//Set connectedCount to this size, if it's bigger
+			if (connected > connectedCount) {
+				connectedCount = connected;
+			}
+		}
+	}
+}
+
+void MapGenerator::hallsWeightedProbs() {
+	//Create halls in steps by weighting probabilities based on the other rooms
+		//Approach:
+		//Extend a door based on a Markov chain, probabilities based on distance to other rooms
+		//Treat rooms as masses with a center of gravity, use x and y component vectors (with 0,0 as the current tile)
+		//Ground tiles and doors of origin room should have negative gravity (the goal is to move away from this!)
+		//Border tiles also have fixed negative gravity. Traveled tiles and their adjacent tiles are 0 probability
+		//No need to normalize totals, since rng produces a big result. Use a modulus of sum of 4 path probabilities
+		//Consider clamping negatives to 0, or add to all 4 paths such that the lowest is 0
+		//Cornered paths are canceled, start a new search
+		//Gravity of every room is summed once per tile, then the origin room's pull is flipped for each step.
+		//That adds the same terms in another order than summing every room per step, so rounding can differ
+		//and a few seeds give a different layout than before the sum was cached
+		//Halls, doors and explored tiles are tracked in per-tile maps so a step never scans other halls or doors
+
+	//Convenience parameters
+	typedef std::pair<sf::Vector2i, int> doorType; //Door location and index of its room
+	sf::Vector2i paths[4] = {
+		sf::Vector2i(1,0),
+		sf::Vector2i(-1,0),
+		sf::Vector2i(0,1),
+		sf::Vector2i(0,-1)
+	};
+	//Add the pull of one room on a tile to the 4 path probabilities. Pull is linear in mass, so a negative mass pushes away
+	auto addRoomPull = [](const room& r, sf::Vector2i tile, float mass, float* probs) {
+		sf::Vector2f roomCenter = { r.position.x + r.size.x / 2.f, r.position.y + r.size.y / 2.f };
+		sf::Vector2f doorCenter = { tile.x + 0.5f, tile.y + 0.5f };
+		sf::Vector2f distance = roomCenter - doorCenter;
+		float distanceMag = std::sqrtf(std::powf(distance.x, 2.f) + std::powf(distance.y, 2.f));
+		float forceMag = mass / std::powf(distanceMag, 2.f);
+		sf::Vector2f forceDir = distance / distanceMag;
+		sf::Vector2f force = forceMag * forceDir;
+		//Find force to increase probability of traveling in a direction. Sign of distance chooses which path is increased
+		if (distance.x > 0) {
+			probs[0] += std::copysignf(force.x, mass);
+		}
+		else if (distance.x < 0) {
+			probs[1] += std::copysignf(force.x, mass);
+		}
+		if (distance.y > 0) {
+			probs[2] += std::copysignf(force.y, mass);
+		}
+		else if (distance.y < 0) {
+			probs[3] += std::copysignf(force.y, mass);
+		}
+	};
+	//Algorithm parameters
+	std::vector<doorType> doors;
+	const int borderBuffer = 1; //The space between room and outer border needs to be at least 1
+	//Per-tile lookups
+	std::vector<float> gravityField(tileCount * 4, 0.f); //Summed pull of all rooms, filled the first time a hall reaches a tile
+	std::vector<bool> gravityReady(tileCount, false);
+	std::vector<int> doorOwner(tileCount, -1); //Room whose door ring contains the tile
+	std::vector<bool> openDoor(tileCount, false); //Door tiles that haven't been used by a finished hall
+	std::vector<int> hallOwner(tileCount, -1); //Origin room of the first finished hall on the tile
+	std::vector<int> exploredStamp(tileCount, 0); //Tiles explored by the hall attempt with the matching stamp
+	int hallStamp = 0;
+	//Start algorithm
+	if (!rooms.empty()) {
+		int roomCount = rooms.size();
+		int connectedCount = 1;
+		//Determine door locations (determined by the bordering wall tiles)
+		for (int r = 0; r < roomCount; ++r) {
+			room& rm = rooms[r];
+			rm.firstDoor = doorTiles.size();
+			//Find top and bottom doors
+			for (int y = rm.position.y - 1; y <= rm.position.y + rm.size.y; y += rm.size.y + 1) {
+				for (int x = rm.position.x; x < rm.position.x + rm.size.x; ++x) {
+					//Add door if location is valid
+					if (x > borderBuffer && y > borderBuffer && x < tilesPerRow - borderBuffer - 1 && y < tilesPerCol - borderBuffer - 1) {
+						doorType newDoor = { sf::Vector2i(x,y), r };
+						doors.push_back(newDoor);
+						doorTiles.push_back(newDoor.first);
+						doorOwner[intXYtoN(x, y)] = r;
+						openDoor[intXYtoN(x, y)] = true;
+						//tiles[intXYtoN(x, y)] = water;
+					}
+				}
+			}
+			//Find left and right doors
+			for (int x = rm.position.x - 1; x <= rm.position.x + rm.size.x; x += rm.size.x + 1) {
+				for (int y = rm.position.y; y < rm.position.y + rm.size.y; ++y) {
+					//Add door if location is valid
+					if (x > borderBuffer && y > borderBuffer && x < tilesPerRow - borderBuffer - 1 && y < tilesPerCol - borderBuffer - 1) {
+						doorType newDoor = { sf::Vector2i(x,y), r };
+						doors.push_back(newDoor);
+						doorTiles.push_back(newDoor.first);
+						doorOwner[intXYtoN(x, y)] = r;
+						openDoor[intXYtoN(x, y)] = true;
+						//tiles[intXYtoN(x, y)] = water;
+					}
+				}
+			}
+			rm.doorCount = doorTiles.size() - rm.firstDoor;
+		}
+		int doorCount;
+		doorType currentDoor;
+		std::vector<int> tempHall;
+		float pathProbs[4] = { 0,0,0,0 }; //Direction: 0 +x, 1 -x, 2 +y, 3 -y
+		bool buildingHall;
+		while (connectedCount < roomCount) {
+			//Choose a random door
+			doorCount = doors.size();
+			if (doorCount == 0)
+				break;
+			currentDoor = doors[rng() % doorCount];
+			int currentRoom = currentDoor.second;
+			const room& origin = rooms[currentRoom];
+			float currentMass = origin.size.x * origin.size.y;
+			//Begin building hallway
+			buildingHall = true;
+			tempHall.clear();
+			++hallStamp;
+			sf::Vector2i tempDoor = currentDoor.first; //This is the test location of the hall, as if the door extruded outwards
+			int tempTile = intXYtoN(tempDoor.x, tempDoor.y);
+			tempHall.push_back(tempTile);
+			exploredStamp[tempTile] = hallStamp;
+			int lastDir = 4; //Index for the last direction traveled. Starts at 4 so that first pass doesn't use this
+			while (buildingHall) {
+				//Find gravity along x and y, summing every room the first time this tile is reached
+				if (!gravityReady[tempTile]) {
+					for (const room& r : rooms) {
+						addRoomPull(r, tempDoor, r.size.x * r.size.y, &gravityField[tempTile * 4]);
+					}
+					gravityReady[tempTile] = true;
+				}
+				for (int i = 0; i < 4; ++i)
+					pathProbs[i] = gravityField[tempTile * 4 + i];
+				//Origin room, so flip its mass to move away rapidly (remove its pull, then add it back negated)
+				addRoomPull(origin, tempDoor, -2.f * currentMass, pathProbs);
+				//Set all probabilities to non-negative by subtracting most negative number
+				float offset = *std::min_element(pathProbs, pathProbs + 4);
+				if (offset < 0) {
+					for (int i = 0; i < 4; ++i) {
+						pathProbs[i] -= offset;
+					}
+				}
+				//Impose constraints and add to total for rng modulus
+				int dirMod = 0;
+				sf::Vector2i tempPath;
+				for (int i = 0; i < 4; ++i) {
+					tempPath = tempDoor + paths[i];
+					//Is the path a floor tile of the origin room?
+					if (tempPath > origin.position && tempPath < origin.position + origin.size) {
+						pathProbs[i] = 0;
+						continue;
+					}
+					//Is the path a door of the origin room?
+					if (doorOwner[intXYtoN(tempPath.x, tempPath.y)] == currentRoom) {
+						pathProbs[i] = 0;
+						continue;
+					}
+					//Is the path a border tile?
+					if (tempPath.x == 0 || tempPath.x == tilesPerRow - 1 || tempPath.y == 0 || tempPath.y == tilesPerCol - 1) {
+						pathProbs[i] = 0;
+						continue;
+					}
+					//Is the path on an explored tile?
+					if (exploredStamp[intXYtoN(tempPath.x, tempPath.y)] == hallStamp) {
+						pathProbs[i] = 0;
+						continue;
+					}
+					//Add a bonus if this is the same direction as last step
+					if (lastDir == i)
+						pathProbs[i] *= 2.f;
+					//Increase total modulus for the roll. If a number to add is 0, this getting skipped is inconsequential
+					dirMod += int(1000 * pathProbs[i]);
+				}
+				//Roll to check the direction
+				if (dirMod > 0) {
+					int dir = rng() % dirMod;
+					int dirCheck = 0;
+					for (int i = 0; i < 4; ++i) {
+						//Increase the check
+						dirCheck += int(1000 * pathProbs[i]);
+						//The rng rolled more than last check, but lower than this check, so end loop and use new path
+						if (dir < dirCheck) {
+							tempDoor += paths[i];
+							tempTile = intXYtoN(tempDoor.x, tempDoor.y);
+							tempHall.push_back(tempTile);
+							exploredStamp[tempTile] = hallStamp;
+							//Update last direction with this new one
+							lastDir = i;
+							break;
+						}
+					}
+					//Check if this new location is a hall, or a door of another room
+					int connectedRoom = -1;
+					bool hitDoor = false;
+					if (hallOwner[tempTile] >= 0) {
+						connectedRoom = hallOwner[tempTile];
+					}
+					else if (openDoor[tempTile] && doorOwner[tempTile] != currentRoom) {
+						connectedRoom = doorOwner[tempTile];
+						hitDoor = true;
+					}
+					if (connectedRoom >= 0) {
+						//Hall complete, end this while loop
+						buildingHall = false;
+						//Add the connecting rooms' set of rooms to each other
+						int connected = connectRooms(currentRoom, connectedRoom);
+						//Set connectedCount to this size, if it's bigger
+						if (connected > connectedCount) {
+							connectedCount = connected;
+						}
+						//Set all tiles in the temporary hall to actual ground tiles, and claim unowned ones for this hall
+						for (int t : tempHall) {
+							tiles[t] = ground;
+							if (hallOwner[t] < 0)
+								hallOwner[t] = currentRoom;
+						}
+						//Remove the doors from the vector
+						if (hitDoor) {
+							doors.erase(std::find(doors.begin(), doors.end(), doorType(tempDoor, connectedRoom)));
+							openDoor[tempTile] = false;
+						}
+						doors.erase(std::find(doors.begin(), doors.end(), currentDoor));
+						openDoor[intXYtoN(currentDoor.first.x, currentDoor.first.y)] = false;
+					}
+				}
+				//If dirMod is 0, then the hallway hit a dead end
+				else {
+					buildingHall = false;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "Map.h"
+#include "ThreadPool.h"
+#include <cstdint>
+
+//Builds rooms and halls into its own grid, independent of any Map or window
+class MapGenerator {
+public:
+	MapGenerator(int tilesInRow, int tilesInCol, genParams parameters = genParams());
+
+	//Generate with an existing rng, which is advanced by the generation
+	mapLayout generate(std::minstd_rand& random);
+	//Generate a map that depends only on its seed, size and parameters
+	static mapLayout generate(int seed, int tilesInRow, int tilesInCol, genParams parameters = genParams());
+	//Generate one map per seed on the pool, results are in the same order as the seeds
+	static std::vector<mapLayout> generateMany(ThreadPool& pool, const std::vector<int>& seeds, int tilesInRow, int tilesInCol, genParams parameters = genParams());
+	//Fewest tiles a map can have across or down, rooms are placed in what's left inside the border
+	static int smallestSide(const genParams& parameters) { return parameters.minRoomSize + 2; }
+
+private:
+	int tilesPerRow;
+	int tilesPerCol;
+	int tileCount;
+	genParams params;
+	std::minstd_rand rng;
+	std::vector<tiletype> tiles;
+	std::vector<room> rooms;
+	std::vector<sf::Vector2i> doorTiles;
+	std::vector<std::uint64_t> connectedBits; //One row of bits per room, marking the rooms it knows it's connected to
+	int connectedWords = 0; //64 bit words in each row
+
+	int intXYtoN(int x, int y);
+	void resetConnections();
+	int connectRooms(int a, int b);
+	void hallsByPairs();
+	void hallsWeightedProbs();
+};
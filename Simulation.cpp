@@ -0,0 +1,282 @@
+#include "stdafx.h"
+#include "Simulation.h"
+#include <algorithm>
+
+Simulation::Simulation(Map& mref, sf::Time tickLength) : unitIndex(mref.tilesPerRow, mref.tilesPerCol), vision(mref), crowd(mref, &workers), search(mref), running(false) {
+	mapref = &mref;
+	step = tickLength;
+}
+
+Simulation::~Simulation() {
+	stopThread();
+}
+
+Unit& Simulation::addUnit(bool isEnemy, int pos) {
+	units.emplace_back(*mapref, isEnemy, pos);
+	Unit& u = units.back();
+	u.id = unitById.size();
+	u.occupancy = &unitIndex;
+	u.crowdOccupancy = &crowd.index;
+	unitById.push_back(&u);
+	unitIndex.insert(u.id, pos);
+	publish();
+	return u;
+}
+
+void Simulation::queueInput(const simInput& input) {
+	//Merge with input that hasn't been used by a tick yet. One-off events stay set, held state takes the newest value
+	std::lock_guard<std::mutex> guard(inputLock);
+	pendingInput.newClick |= input.newClick;
+	pendingInput.endClick |= input.endClick;
+	pendingInput.testPath |= input.testPath;
+	pendingInput.rebuildMap |= input.rebuildMap;
+	pendingInput.clickDown = input.clickDown;
+	pendingInput.mousePos = input.mousePos;
+}
+
+void Simulation::advance(sf::Time elapsed) {
+	//Run a tick for every whole step of elapsed time, carrying the rest over to the next call
+	accumulator += elapsed;
+	int ticks = 0;
+	while (accumulator >= step && ticks < maxCatchUp) {
+		tick();
+		accumulator -= step;
+		++ticks;
+	}
+	//Too far behind to catch up, so drop the backlog instead of falling further behind every frame
+	if (accumulator >= step) {
+		accumulator = sf::Time::Zero;
+	}
+}
+
+void Simulation::startThread() {
+	if (running)
+		return;
+	running = true;
+	worker = std::thread(&Simulation::threadLoop, this);
+}
+
+void Simulation::stopThread() {
+	if (!running)
+		return;
+	running = false;
+	worker.join();
+}
+
+void Simulation::threadLoop() {
+	sf::Time nextTick = clock.getElapsedTime();
+	while (running) {
+		sf::Time now = clock.getElapsedTime();
+		if (now < nextTick) {
+			sf::sleep(nextTick - now);
+			continue;
+		}
+		int ticks = 0;
+		while (clock.getElapsedTime() >= nextTick && ticks < maxCatchUp) {
+			simTime = nextTick;
+			tick();
+			nextTick += step;
+			++ticks;
+		}
+		if (clock.getElapsedTime() >= nextTick) {
+			nextTick = clock.getElapsedTime() + step;
+		}
+	}
+}
+
+void Simulation::tick() {
+	//Take the input gathered since the last tick
+	simInput input;
+	{
+		std::lock_guard<std::mutex> guard(inputLock);
+		input = pendingInput;
+		pendingInput.newClick = false;
+		pendingInput.endClick = false;
+		pendingInput.testPath = false;
+		pendingInput.rebuildMap = false;
+	}
+	//A new map only appears at a tick boundary, and old paths are searched again on it
+	{
+		std::lock_guard<std::mutex> guard(mapLock);
+		if (mapref->swapPendingMap()) {
+			testPath = true;
+			if (crowd.planner != NULL) {
+				crowd.planner->reset();
+			}
+			for (Unit& u : units) {
+				if (u.goal >= 0) {
+					u.wantsPath = true;
+				}
+			}
+		}
+	}
+	mapref->newClick = input.newClick;
+	mapref->endClick = input.endClick;
+	mapref->clickDown = input.clickDown;
+	mapref->mousePos = input.mousePos;
+	//Selection asks the index who stands on the clicked tile instead of every unit checking
+	if (input.newClick) {
+		found.clear();
+		unitIndex.queryTile(input.mousePos, found);
+		for (int id : found) {
+			unitById[id]->selected = true;
+		}
+	}
+	for (Unit& u : units) {
+		u.update();
+		unitIndex.move(u.id, u.previousPosition, u.position);
+	}
+	crowd.update();
+	acquireTargets();
+	if (input.testPath) {
+		testPath = true;
+	}
+	if (testPath && pathSeeker != NULL && pathTarget != NULL) {
+		pathSeeker->follow(pathTarget);
+		testPath = false;
+	}
+	searchPaths();
+	path.clear();
+	if (pathSeeker != NULL) {
+		path = pathSeeker->astarPath;
+		path.push_front(pathSeeker->position);
+	}
+	if (input.rebuildMap) {
+		//Build the new map in the background so ticks keep running on the current one
+		mapref->generateMapAsync(1);
+	}
+	++tickCount;
+	publish();
+}
+
+void Simulation::acquireTargets() {
+	//Units that hunt by themselves follow the closest unit of the other side that comes into sight. Only other Units are
+	//hunted, crowd units have no Unit to follow
+	for (Unit& u : units) {
+		if (u.sightRadius <= 0.f || u.target != NULL)
+			continue;
+		found.clear();
+		unitIndex.queryRadius(u.position, u.sightRadius, found);
+		//Only work out what the unit sees when someone is close enough to be seen
+		bool looked = false;
+		Unit* closest = NULL;
+		float closestDistance = 0.f;
+		for (int id : found) {
+			Unit* other = unitById[id];
+			if (other->enemyAgent == u.enemyAgent)
+				continue;
+			if (!looked) {
+				vision.compute(u.position, int(u.sightRadius));
+				looked = true;
+			}
+			if (!vision.visible(other->position))
+				continue;
+			sf::Vector2f delta = mapref->getTilePos(other->position) - mapref->getTilePos(u.position);
+			float distance = delta.x * delta.x + delta.y * delta.y;
+			if (closest == NULL || distance < closestDistance) {
+				closest = other;
+				closestDistance = distance;
+			}
+		}
+		if (closest != NULL) {
+			u.follow(closest);
+		}
+	}
+}
+
+void Simulation::searchPaths() {
+	//Units asking for a path wait in line, so thousands asking at once spread their searches over several ticks
+	for (Unit& u : units) {
+		if (u.wantsPath && !u.pathQueued && u.repathCooldown == 0) {
+			u.pathQueued = true;
+			repathQueue.push_back(&u);
+		}
+	}
+	//With more units waiting than get searched this tick, searches are cut short (ARA*) and improved once it's quiet
+	bool busy = int(repathQueue.size()) > maxRepathsPerTick;
+	for (int i = 0; i < maxRepathsPerTick && !repathQueue.empty(); ++i) {
+		Unit* u = repathQueue.front();
+		repathQueue.pop_front();
+		u->pathQueued = false;
+		if (!u->wantsPath || u->goal < 0)
+			continue;
+		if (u->blockedTile >= 0) {
+			//Go around the unit in the way. Map::astar and the precomputed searches can't leave a tile out, so those use
+			//A* instead. Without a way around, keep the current path and wait for the tile to clear
+			search.blockedTile = u->blockedTile;
+			bool precomputed = unitSearch == classicSearch || unitSearch == firstMoveSearch || unitSearch == hierarchySearch;
+			searchResult around = busy ? search.anytime(u->position, u->goal, hurriedSearch)
+				: search.find(u->position, u->goal, precomputed ? astarSearch : unitSearch);
+			search.blockedTile = -1;
+			u->blockedTile = -1;
+			if (!around.path.empty()) {
+				u->setPath(std::list<int>(around.path.begin(), around.path.end()));
+				u->pathBound = busy ? around.bound : 1.f;
+			}
+			else {
+				u->wantsPath = false;
+				u->repathCooldown = u->repathInterval;
+			}
+			continue;
+		}
+		if (busy) {
+			searchResult quick = search.anytime(u->position, u->goal, hurriedSearch);
+			u->setPath(quick.path.empty() ? std::list<int>{ u->position } : std::list<int>(quick.path.begin(), quick.path.end()));
+			u->pathBound = quick.bound;
+		}
+		else {
+			u->setPath(mapref->findPath(u->position, u->goal, unitSearch));
+			u->pathBound = 1.f;
+		}
+	}
+	if (!busy) {
+		for (Unit& u : units) {
+			if (u.pathBound > 1.f && !u.wantsPath && u.repathCooldown == 0) {
+				u.wantsPath = true;
+			}
+		}
+	}
+}
+
+void Simulation::publish() {
+	//Copy out what the renderer needs, so it never reads units while a tick changes them
+	simSnapshot snapshot;
+	snapshot.units.reserve(units.size());
+	for (const Unit& u : units) {
+		unitSnapshot s;
+		s.previousPosition = u.previousPosition;
+		s.position = u.position;
+		s.previousPixel = u.previousPixel;
+		s.pixel = u.pixel;
+		s.selected = u.selected;
+		s.enemyAgent = u.enemyAgent;
+		s.radius = u.shape.getRadius();
+		s.color = u.shape.getFillColor();
+		snapshot.units.push_back(s);
+	}
+	snapshot.path = path;
+	snapshot.crowdPrevious = crowd.previousPosition;
+	snapshot.crowdPosition = crowd.position;
+	snapshot.crowdEnemy = crowd.enemyAgent;
+	snapshot.tick = tickCount;
+	snapshot.tickTime = simTime;
+	std::lock_guard<std::mutex> guard(snapshotLock);
+	published = std::move(snapshot);
+}
+
+simSnapshot Simulation::getSnapshot() {
+	std::lock_guard<std::mutex> guard(snapshotLock);
+	return published;
+}
+
+float Simulation::interpolation(const simSnapshot& snapshot) {
+	float alpha;
+	if (running) {
+		//Time since the tick was due, on the same clock the thread schedules with
+		alpha = (clock.getElapsedTime() - snapshot.tickTime).asSeconds() / step.asSeconds();
+	}
+	else {
+		alpha = accumulator.asSeconds() / step.asSeconds();
+	}
+	return std::min(std::max(alpha, 0.f), 1.f);
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "Map.h"
+#include "Unit.h"
+#include "UnitSystem.h"
+#include "ThreadPool.h"
+#include "SpatialHash.h"
+#include "LineOfSight.h"
+#include "GridSearch.h"
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
+
+//Input gathered between ticks. Events are latched until a tick consumes them, so none are lost between ticks
+struct simInput {
+	bool newClick = false;
+	bool endClick = false;
+	bool clickDown = false;
+	int mousePos = -1;
+	bool testPath = false;
+	bool rebuildMap = false;
+};
+
+//Everything the renderer needs from one tick
+struct unitSnapshot {
+	int previousPosition;
+	int position;
+	sf::Vector2f previousPixel;
+	sf::Vector2f pixel;
+	bool selected;
+	bool enemyAgent;
+	float radius;
+	sf::Color color;
+};
+
+struct simSnapshot {
+	std::vector<unitSnapshot> units;
+	std::list<int> path;
+	//Crowd units as parallel arrays, copied straight from the UnitSystem
+	std::vector<int> crowdPrevious;
+	std::vector<int> crowdPosition;
+	std::vector<uint8_t> crowdEnemy;
+	unsigned tick = 0;
+	sf::Time tickTime; //When this tick was due, on the simulation's clock
+};
+
+//Runs units and path queries at a fixed rate, on the calling thread or on its own
+class Simulation {
+public:
+	Map* mapref;
+	sf::Time step;
+	std::list<Unit> units; //A list so units keep their address as more are added
+	std::vector<Unit*> unitById;
+	SpatialHash unitIndex; //Unit ids by tile, kept up to date as units move
+	FieldOfView vision; //What the unit acquiring targets sees, reused for every unit and tick
+	ThreadPool workers;
+	UnitSystem crowd; //Large numbers of simple units, updated in parallel chunks
+	Unit* pathSeeker = NULL; //The path query runs from this unit to the target
+	Unit* pathTarget = NULL;
+	std::mutex mapLock; //Held while the map's tiles are swapped, hold it to read tiles from another thread
+	static const int maxCatchUp = 5; //Ticks run at most per advance before the backlog is dropped
+	int maxRepathsPerTick = 8; //Unit path searches run per tick, the rest wait in line for later ticks
+	searchMode unitSearch = astarSearch; //Tile by tile, so units see every occupied tile. Any-angle paths jump past other units
+	sf::Time hurriedSearch = sf::microseconds(200); //Time an anytime search gets per unit while the search queue is backed up
+	GridSearch search;
+
+	Simulation(Map& mref, sf::Time tickLength);
+	~Simulation();
+	Unit& addUnit(bool isEnemy, int pos);
+
+	void queueInput(const simInput& input);
+	//Single threaded use: run every tick that's due after elapsed more time has passed
+	void advance(sf::Time elapsed);
+	//Threaded use: ticks run on their own thread until stopThread
+	void startThread();
+	void stopThread();
+
+	//Run one tick right away, for headless runs that aren't paced by a clock
+	void tick();
+
+	simSnapshot getSnapshot();
+	//How far rendering is between the snapshot's previous and current positions, 0 to 1
+	float interpolation(const simSnapshot& snapshot);
+
+private:
+	std::mutex inputLock;
+	simInput pendingInput;
+	std::mutex snapshotLock;
+	simSnapshot published;
+	sf::Clock clock;
+	sf::Time accumulator;
+	sf::Time simTime;
+	unsigned tickCount = 0;
+	bool testPath = true;
+	std::list<int> path;
+	std::deque<Unit*> repathQueue;
+	std::vector<int> found; //Reused for index queries
+	std::thread worker;
+	std::atomic<bool> running;
+
+	void acquireTargets();
+	void searchPaths();
+	void publish();
+	void threadLoop();
+};
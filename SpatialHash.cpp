@@ -0,0 +1,136 @@
+#include "stdafx.h"
+#include "SpatialHash.h"
+#include <algorithm>
+#include <cmath>
+
+SpatialHash::SpatialHash(int tilesInRow, int tilesInCol, int bucketSize) {
+	bucketTiles = std::max(bucketSize, 1);
+	reset(tilesInRow, tilesInCol);
+}
+
+void SpatialHash::reset(int tilesInRow, int tilesInCol) {
+	tilesPerRow = tilesInRow;
+	tilesPerCol = tilesInCol;
+	bucketsPerRow = (tilesPerRow + bucketTiles - 1) / bucketTiles;
+	bucketsPerCol = (tilesPerCol + bucketTiles - 1) / bucketTiles;
+	buckets.assign(bucketsPerRow * bucketsPerCol, std::vector<entry>());
+	slotOf.clear();
+}
+
+int SpatialHash::bucketOf(int tile) const {
+	return (tile % tilesPerRow) / bucketTiles + (tile / tilesPerRow) / bucketTiles * bucketsPerRow;
+}
+
+void SpatialHash::insert(int id, int tile) {
+	if (tile < 0 || tile >= tilesPerRow * tilesPerCol)
+		return;
+	if (id >= int(slotOf.size())) {
+		slotOf.resize(id + 1, -1);
+	}
+	std::vector<entry>& bucket = buckets[bucketOf(tile)];
+	entry e = { id, tile };
+	slotOf[id] = bucket.size();
+	bucket.push_back(e);
+}
+
+void SpatialHash::remove(int id, int tile) {
+	if (tile < 0 || tile >= tilesPerRow * tilesPerCol)
+		return;
+	if (id >= int(slotOf.size()) || slotOf[id] < 0)
+		return;
+	std::vector<entry>& bucket = buckets[bucketOf(tile)];
+	int slot = slotOf[id];
+	//Order inside a bucket doesn't matter, so fill the hole with the last entry
+	bucket[slot] = bucket.back();
+	slotOf[bucket[slot].id] = slot;
+	bucket.pop_back();
+	slotOf[id] = -1;
+}
+
+void SpatialHash::move(int id, int from, int to) {
+	if (from == to)
+		return;
+	if (from >= 0 && to >= 0 && from < tilesPerRow * tilesPerCol && to < tilesPerRow * tilesPerCol && bucketOf(from) == bucketOf(to)) {
+		//Most steps stay in the same bucket, only the tile changes
+		if (id < int(slotOf.size()) && slotOf[id] >= 0) {
+			buckets[bucketOf(from)][slotOf[id]].tile = to;
+			return;
+		}
+	}
+	remove(id, from);
+	insert(id, to);
+}
+
+int SpatialHash::queryTile(int tile, std::vector<int>& found) const {
+	if (tile < 0 || tile >= tilesPerRow * tilesPerCol)
+		return 0;
+	int count = 0;
+	for (const entry& e : buckets[bucketOf(tile)]) {
+		if (e.tile == tile) {
+			found.push_back(e.id);
+			++count;
+		}
+	}
+	return count;
+}
+
+int SpatialHash::queryRect(sf::IntRect area, std::vector<int>& found) const {
+	int left = std::max(area.left, 0);
+	int top = std::max(area.top, 0);
+	int right = std::min(area.left + area.width, tilesPerRow) - 1;
+	int bottom = std::min(area.top + area.height, tilesPerCol) - 1;
+	if (left > right || top > bottom)
+		return 0;
+	int count = 0;
+	for (int by = top / bucketTiles; by <= bottom / bucketTiles; ++by) {
+		for (int bx = left / bucketTiles; bx <= right / bucketTiles; ++bx) {
+			for (const entry& e : buckets[bx + by * bucketsPerRow]) {
+				int x = e.tile % tilesPerRow;
+				int y = e.tile / tilesPerRow;
+				if (x >= left && x <= right && y >= top && y <= bottom) {
+					found.push_back(e.id);
+					++count;
+				}
+			}
+		}
+	}
+	return count;
+}
+
+int SpatialHash::queryRadius(int tile, float radius, std::vector<int>& found) const {
+	if (tile < 0 || tile >= tilesPerRow * tilesPerCol || radius < 0.f)
+		return 0;
+	int cx = tile % tilesPerRow;
+	int cy = tile / tilesPerRow;
+	int reach = int(std::floor(radius));
+	int left = std::max(cx - reach, 0);
+	int top = std::max(cy - reach, 0);
+	int right = std::min(cx + reach, tilesPerRow - 1);
+	int bottom = std::min(cy + reach, tilesPerCol - 1);
+	float radiusSquared = radius * radius;
+	int count = 0;
+	for (int by = top / bucketTiles; by <= bottom / bucketTiles; ++by) {
+		for (int bx = left / bucketTiles; bx <= right / bucketTiles; ++bx) {
+			for (const entry& e : buckets[bx + by * bucketsPerRow]) {
+				float dx = float(e.tile % tilesPerRow - cx);
+				float dy = float(e.tile / tilesPerRow - cy);
+				if (dx * dx + dy * dy <= radiusSquared) {
+					found.push_back(e.id);
+					++count;
+				}
+			}
+		}
+	}
+	return count;
+}
+
+bool SpatialHash::occupied(int tile, int ignoreId) const {
+	if (tile < 0 || tile >= tilesPerRow * tilesPerCol)
+		return false;
+	for (const entry& e : buckets[bucketOf(tile)]) {
+		if (e.tile == tile && e.id != ignoreId) {
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+//Finds which units stand where without looking at every unit. The map is cut into square buckets of tiles,
+//and each bucket lists the ids on its tiles, so a query only reads the buckets it overlaps.
+//Ids are small numbers such as unit indices, since the hash keeps a slot per id
+class SpatialHash {
+public:
+	struct entry {
+		int id;
+		int tile;
+	};
+
+	int tilesPerRow = 0;
+	int tilesPerCol = 0;
+	int bucketTiles; //Width and height of a bucket in tiles
+	int bucketsPerRow = 0;
+	int bucketsPerCol = 0;
+	std::vector<std::vector<entry>> buckets;
+	std::vector<int> slotOf; //Where each id sits inside its bucket, so it's found without a search
+
+	SpatialHash(int tilesInRow, int tilesInCol, int bucketSize = 4);
+	//Forget every id and fit a map of a new size
+	void reset(int tilesInRow, int tilesInCol);
+	void insert(int id, int tile);
+	void remove(int id, int tile);
+	void move(int id, int from, int to);
+
+	//Queries add the ids they find to found and return how many they added
+	int queryTile(int tile, std::vector<int>& found) const;
+	int queryRect(sf::IntRect area, std::vector<int>& found) const; //Area in tiles
+	int queryRadius(int tile, float radius, std::vector<int>& found) const; //Radius in tiles, measured between tile centres
+	bool occupied(int tile, int ignoreId = -1) const;
+
+private:
+	int bucketOf(int tile) const;
+};
@@ -0,0 +1,50 @@
+#include "stdafx.h"
+#include "SpriteBatch.h"
+#include <cmath>
+#include <algorithm>
+
+SpriteBatch::SpriteBatch() : quads(sf::Quads) {
+}
+
+void SpriteBatch::clear() {
+	//Keeps the vertex memory, so refilling every frame doesn't allocate
+	quads.clear();
+}
+
+void SpriteBatch::addCircle(sf::Vector2f center, float radius, sf::Color color) {
+	const float texSize = float(circleTextureSize);
+	quads.append(sf::Vertex(center + sf::Vector2f(-radius, -radius), color, sf::Vector2f(0.f, 0.f)));
+	quads.append(sf::Vertex(center + sf::Vector2f(radius, -radius), color, sf::Vector2f(texSize, 0.f)));
+	quads.append(sf::Vertex(center + sf::Vector2f(radius, radius), color, sf::Vector2f(texSize, texSize)));
+	quads.append(sf::Vertex(center + sf::Vector2f(-radius, radius), color, sf::Vector2f(0.f, texSize)));
+}
+
+void SpriteBatch::draw(sf::RenderTarget& target) {
+	if (quads.getVertexCount() == 0)
+		return;
+	//The texture needs a graphics context, so it's made on the first draw
+	if (!textureReady) {
+		buildTexture();
+	}
+	sf::RenderStates states;
+	states.texture = &circleTexture;
+	target.draw(quads, states);
+}
+
+void SpriteBatch::buildTexture() {
+	//White disc with a one pixel soft edge, so circles stay smooth when scaled
+	sf::Image image;
+	image.create(circleTextureSize, circleTextureSize, sf::Color::Transparent);
+	const float radius = circleTextureSize / 2.f;
+	for (int y = 0; y < circleTextureSize; ++y) {
+		for (int x = 0; x < circleTextureSize; ++x) {
+			float dx = x + 0.5f - radius;
+			float dy = y + 0.5f - radius;
+			float coverage = std::min(std::max(radius - std::sqrt(dx * dx + dy * dy), 0.f), 1.f);
+			image.setPixel(x, y, sf::Color(255, 255, 255, sf::Uint8(255 * coverage)));
+		}
+	}
+	circleTexture.loadFromImage(image);
+	circleTexture.setSmooth(true);
+	textureReady = true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+
+//Collects circles as textured quads and draws all of them with one call
+//The shared texture is a white circle, so each quad's vertex colour tints it
+class SpriteBatch {
+public:
+	static const int circleTextureSize = 64;
+
+	SpriteBatch();
+	void clear();
+	void addCircle(sf::Vector2f center, float radius, sf::Color color);
+	void draw(sf::RenderTarget& target);
+
+private:
+	sf::VertexArray quads;
+	sf::Texture circleTexture;
+	bool textureReady = false;
+
+	void buildTexture();
+};
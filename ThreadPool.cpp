@@ -0,0 +1,93 @@
+#include "stdafx.h"
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned threadCount) : nextIndex(0) {
+	if (threadCount == 0) {
+		threadCount = std::thread::hardware_concurrency();
+	}
+	//The thread calling parallelFor works too, so start one fewer worker
+	for (unsigned i = 1; i < threadCount; ++i) {
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& t : workers)
+		t.join();
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& job) {
+	if (count <= 0)
+		return;
+	//Run inline when there's nobody to share with
+	if (workers.empty() || count == 1) {
+		for (int i = 0; i < count; ++i)
+			job(i);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		currentJob = &job;
+		jobCount = count;
+		nextIndex = 0;
+		busyWorkers = workers.size();
+		failure = NULL;
+		++generation;
+	}
+	wake.notify_all();
+	runJobs(job, count);
+	//Wait until every worker has let go of the job before it goes out of scope
+	std::unique_lock<std::mutex> guard(lock);
+	finished.wait(guard, [this] { return busyWorkers == 0; });
+	currentJob = NULL;
+	if (failure) {
+		std::exception_ptr thrown = failure;
+		failure = NULL;
+		std::rethrow_exception(thrown);
+	}
+}
+
+void ThreadPool::workerLoop() {
+	unsigned seenGeneration = 0;
+	while (true) {
+		const std::function<void(int)>* job;
+		int count;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [&] { return stopping || generation != seenGeneration; });
+			if (stopping)
+				return;
+			seenGeneration = generation;
+			job = currentJob;
+			count = jobCount;
+		}
+		runJobs(*job, count);
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			--busyWorkers;
+		}
+		finished.notify_one();
+	}
+}
+
+void ThreadPool::runJobs(const std::function<void(int)>& job, int count) {
+	//Grab indices one at a time so uneven jobs still balance out. A throwing job is caught here, so every thread still
+	//reports back and parallelFor doesn't wait forever, and the remaining indices are skipped
+	for (int i = nextIndex++; i < count; i = nextIndex++) {
+		try {
+			job(i);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> guard(lock);
+			if (!failure) {
+				failure = std::current_exception();
+			}
+			nextIndex = count;
+		}
+	}
+}
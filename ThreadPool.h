@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+
+//A fixed set of worker threads that split loops between them
+class ThreadPool {
+public:
+	ThreadPool(unsigned threadCount = 0); //0 uses one thread per hardware core
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator = (const ThreadPool&) = delete;
+
+	unsigned size() const { return workers.size() + 1; } //The calling thread also runs jobs
+	//Call job(i) for every i in [0, count) and return once all calls finished. When a call throws, no more calls are
+	//started and the first exception is thrown again here once the running ones are done
+	void parallelFor(int count, const std::function<void(int)>& job);
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable finished;
+	const std::function<void(int)>* currentJob = NULL;
+	int jobCount = 0;
+	std::atomic<int> nextIndex;
+	int busyWorkers = 0;
+	std::exception_ptr failure; //First exception a job threw
+	unsigned generation = 0;
+	bool stopping = false;
+
+	void workerLoop();
+	void runJobs(const std::function<void(int)>& job, int count);
+};
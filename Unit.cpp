@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "Unit.h"
+#include <cmath>
 
 Unit::Unit(Map& mref, bool isEnemy, int pos) {
 	mapref = &mref;
@@ -12,46 +13,119 @@ Unit::Unit(Map& mref, bool isEnemy, int pos) {
 		shape.setFillColor(sf::Color::Blue);
 	}
 	position = pos;
+	previousPosition = pos;
+	pixel = currentPixel();
+	previousPixel = pixel;
 }
 
-void Unit::update(sf::RenderWindow& window) {
-	drawUnit(window);
-	selectUnit();
-	dragUnit(window);
+void Unit::update() {
+	//One simulation tick. Drawing happens separately from a snapshot of the units
+	previousPosition = position;
+	previousPixel = pixel;
+	if (repathCooldown > 0) {
+		--repathCooldown;
+	}
 	moveUnit();
+	followPath();
+	pixel = currentPixel();
 }
 
-void Unit::drawUnit(sf::RenderWindow& window) {
-	shape.setPosition(mapref->getTilePos(position));
-	window.draw(shape);
+void Unit::walkTo(int tile) {
+	target = NULL;
+	goal = tile;
+	wantsPath = true;
 }
 
-void Unit::selectUnit() {
-	if (mapref->newClick && mapref->mousePos == position) {
-		selected = true;
-		if (enemyAgent) {
-			mapref->previewUnitDrop.setFillColor(sf::Color(255, 0, 0, 127));
-		}
-		else {
-			mapref->previewUnitDrop.setFillColor(sf::Color(0, 0, 255, 127));
-		}
-	}
+void Unit::follow(Unit* other) {
+	target = other;
+	goal = other->position;
+	wantsPath = true;
 }
 
-void Unit::dragUnit(sf::RenderWindow& window) {
-	if (mapref->clickDown && selected) {
-		if (mapref->tiles[mapref->mousePos] != wall) {
-			mapref->previewUnitDrop.setPosition(mapref->getTilePos(mapref->mousePos));
-			window.draw(mapref->previewUnitDrop);
-		}
+void Unit::setPath(const std::list<int>& path) {
+	int oldNext = astarPath.empty() ? -1 : astarPath.front();
+	astarPath = path;
+	if (!astarPath.empty() && astarPath.front() == position) {
+		astarPath.pop_front();
 	}
+	//Keep walking the current step only if the new path takes it too
+	if (astarPath.empty() || astarPath.front() != oldNext) {
+		stepProgress = 0.f;
+	}
+	//A failed search leaves the path empty, and the unit waits for its goal to move instead of searching every tick
+	wantsPath = false;
+	repathCooldown = repathInterval;
 }
 
 void Unit::moveUnit() {
 	if (mapref->endClick && selected) {
-		if (mapref->tiles[mapref->mousePos] != wall) {
+		if (mapref->mousePos >= 0 && mapref->tiles[mapref->mousePos] != wall) {
 			position = mapref->mousePos;
+			stepProgress = 0.f;
+			astarPath.clear();
+			if (goal >= 0) {
+				wantsPath = true;
+			}
 		}
 		selected = false;
 	}
 }
+
+bool Unit::occupied(int tile) const {
+	return (occupancy != NULL && occupancy->occupied(tile, id)) || (crowdOccupancy != NULL && crowdOccupancy->occupied(tile));
+}
+
+void Unit::followPath() {
+	//A target that moved makes the path lead to the wrong place
+	if (target != NULL && target->position != goal) {
+		goal = target->position;
+		wantsPath = true;
+	}
+	if (selected)
+		return;
+	float budget = speed;
+	while (budget > 0.f && !astarPath.empty()) {
+		int next = astarPath.front();
+		if (next < 0 || next >= mapref->tileCount || mapref->tiles[next] == wall) {
+			//The map changed under the path, go back to the last tile and wait for a new one
+			stepProgress = 0.f;
+			astarPath.clear();
+			wantsPath = true;
+			break;
+		}
+		if (stepProgress <= 0.f && occupied(next)) {
+			//Stop next to the unit being followed, and wait a little for anyone else to move on before asking for a way
+			//around them. Units never walk onto a tile another unit or a crowd unit stands on
+			if (target != NULL && next == goal)
+				break;
+			if (++blockedTicks >= blockedPatience) {
+				blockedTicks = 0;
+				blockedTile = next;
+				wantsPath = true;
+			}
+			break;
+		}
+		blockedTicks = 0;
+		//Any-angle paths jump several tiles at once, so measure the real distance in tiles
+		float dx = float(next % mapref->tilesPerRow - position % mapref->tilesPerRow);
+		float dy = float(next / mapref->tilesPerRow - position / mapref->tilesPerRow);
+		float length = std::sqrt(dx * dx + dy * dy);
+		float needed = (1.f - stepProgress) * length;
+		if (budget < needed) {
+			stepProgress += budget / length;
+			break;
+		}
+		budget -= needed;
+		position = next;
+		astarPath.pop_front();
+		stepProgress = 0.f;
+	}
+}
+
+sf::Vector2f Unit::currentPixel() {
+	sf::Vector2f from = mapref->getTilePos(position);
+	if (astarPath.empty() || stepProgress <= 0.f) {
+		return from;
+	}
+	return from + (mapref->getTilePos(astarPath.front()) - from) * stepProgress;
+}
@@ -1,23 +1,49 @@
 #pragma once
 #include "Map.h"
+#include "SpatialHash.h"
 
 class Unit {
 public:
 	Map* mapref;
-	int position;
+	int id = -1; //Index of the unit in its simulation
+	int position; //Last tile the unit reached
+	int previousPosition; //Position before the last tick
 	bool enemyAgent = false;
 	sf::CircleShape shape;
 
 	bool selected = false;
 
-	std::list<int> astarPath;
+	std::list<int> astarPath; //Tiles still to walk, the next one first
+	float speed = 0.25f; //Tiles walked per tick, diagonal steps count as longer
+	float stepProgress = 0.f; //How far the unit is from position towards the next tile on its path, 0 to 1
+	sf::Vector2f pixel; //Top left of the unit in map pixels, between tiles while walking
+	sf::Vector2f previousPixel; //Rendering blends from here to pixel
+
+	Unit* target = NULL; //Unit to walk to, followed as it moves
+	int goal = -1; //Tile the path leads to
+	bool wantsPath = false; //Set when the path is missing or stale, the simulation decides when to search it
+	int repathCooldown = 0; //Ticks until another path may be searched for this unit
+	int repathInterval = 10; //Ticks a unit waits between path searches
+	bool pathQueued = false; //Waiting in the simulation's search queue
+	float pathBound = 1.f; //How many times longer than the shortest the path may be, above 1 when it was found in a hurry
+	const SpatialHash* occupancy = NULL; //Where the other units stand, a unit waits before stepping onto one of them
+	const SpatialHash* crowdOccupancy = NULL; //Where the crowd units stand, waited for the same way
+	int blockedTicks = 0;
+	int blockedPatience = 5; //Ticks spent waiting for a tile to clear before searching a way around it
+	int blockedTile = -1; //Occupied tile the next path search goes around, -1 for none
+	float sightRadius = 0.f; //Tiles within which a unit goes after the other side by itself, 0 never does
 
 	Unit(Map& mref, bool isEnemy, int pos);
-	void update(sf::RenderWindow& window);
+	void update();
+	//Walk to a tile, or to a unit wherever it goes
+	void walkTo(int tile);
+	void follow(Unit* other);
+	//Take a searched path, which starts at the unit's own tile
+	void setPath(const std::list<int>& path);
 
 private:
-	void drawUnit(sf::RenderWindow& window);
-	void selectUnit();
-	void dragUnit(sf::RenderWindow& window);
 	void moveUnit();
+	void followPath();
+	bool occupied(int tile) const;
+	sf::Vector2f currentPixel();
 };
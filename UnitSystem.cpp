@@ -0,0 +1,172 @@
+#include "stdafx.h"
+#include "UnitSystem.h"
+#include <algorithm>
+
+UnitSystem::UnitSystem(Map& mref, ThreadPool* pool) : index(mref.tilesPerRow, mref.tilesPerCol) {
+	mapref = &mref;
+	workers = pool;
+}
+
+int UnitSystem::addUnit(bool isEnemy, int pos, bool patrols) {
+	position.push_back(pos);
+	previousPosition.push_back(pos);
+	enemyAgent.push_back(isEnemy);
+	selected.push_back(false);
+	patrol.push_back(patrols);
+	pathStart.push_back(0);
+	pathLength.push_back(0);
+	pathCursor.push_back(0);
+	pathDirection.push_back(1);
+	goal.push_back(-1);
+	index.insert(size() - 1, pos);
+	return size() - 1;
+}
+
+void UnitSystem::clear() {
+	position.clear();
+	previousPosition.clear();
+	enemyAgent.clear();
+	selected.clear();
+	patrol.clear();
+	pathStart.clear();
+	pathLength.clear();
+	pathCursor.clear();
+	pathDirection.clear();
+	goal.clear();
+	pathPool.clear();
+	unusedPathTiles = 0;
+	index.reset(mapref->tilesPerRow, mapref->tilesPerCol);
+}
+
+void UnitSystem::setPath(int unit, const int* tiles, int length) {
+	clearPath(unit);
+	//Old paths are left in the pool as holes, and squeezed out once they're half of it
+	if (unusedPathTiles > 1024 && unusedPathTiles * 2 > int(pathPool.size())) {
+		compactPaths();
+	}
+	pathStart[unit] = pathPool.size();
+	pathLength[unit] = length;
+	pathCursor[unit] = 0;
+	pathDirection[unit] = 1;
+	pathPool.insert(pathPool.end(), tiles, tiles + length);
+}
+
+void UnitSystem::setPath(int unit, const std::list<int>& tiles) {
+	std::vector<int> flat(tiles.begin(), tiles.end());
+	setPath(unit, flat.data(), flat.size());
+}
+
+void UnitSystem::clearPath(int unit) {
+	unusedPathTiles += pathLength[unit];
+	pathLength[unit] = 0;
+	pathCursor[unit] = 0;
+}
+
+void UnitSystem::compactPaths() {
+	//Move every live path to the front of the pool, in unit order
+	std::vector<int> compacted;
+	compacted.reserve(pathPool.size() - unusedPathTiles);
+	for (int i = 0; i < size(); ++i) {
+		int start = pathStart[i];
+		pathStart[i] = compacted.size();
+		compacted.insert(compacted.end(), pathPool.begin() + start, pathPool.begin() + start + pathLength[i]);
+	}
+	pathPool.swap(compacted);
+	unusedPathTiles = 0;
+}
+
+void UnitSystem::update() {
+	//Clicks only matter on the ticks they happen, and dropping a unit changes the path pool, so this part stays serial
+	if (mapref->newClick) {
+		found.clear();
+		index.queryTile(mapref->mousePos, found);
+		for (int i : found) {
+			selected[i] = true;
+		}
+	}
+	bool dropped = mapref->endClick && mapref->mousePos >= 0 && mapref->tiles[mapref->mousePos] != wall;
+	if (mapref->endClick) {
+		for (int i = 0; i < size(); ++i) {
+			if (!selected[i])
+				continue;
+			if (dropped) {
+				index.move(i, position[i], mapref->mousePos);
+				position[i] = mapref->mousePos;
+				clearPath(i);
+				ticksUntilPlan = 0;
+			}
+			selected[i] = false;
+		}
+	}
+
+	if (planner != NULL) {
+		planTogether();
+	}
+
+	//Movement only touches each unit's own elements, so chunks of units can run on different threads
+	int chunks = (size() + chunkSize - 1) / chunkSize;
+	if (workers != NULL && chunks > 1) {
+		workers->parallelFor(chunks, [this](int chunk) {
+			moveRange(chunk * chunkSize, std::min((chunk + 1) * chunkSize, size()));
+		});
+	}
+	else {
+		moveRange(0, size());
+	}
+	//The index isn't safe to change from several threads, so it catches up with the moves afterwards
+	for (int i = 0; i < size(); ++i) {
+		if (position[i] != previousPosition[i]) {
+			index.move(i, previousPosition[i], position[i]);
+		}
+	}
+}
+
+void UnitSystem::planTogether() {
+	//Plans are a window of steps, one per tick, so the units walk part of one and then get the next
+	if (--ticksUntilPlan > 0)
+		return;
+	ticksUntilPlan = planner->replanInterval;
+	plannedUnits.clear();
+	planStarts.clear();
+	planGoals.clear();
+	for (int i = 0; i < size(); ++i) {
+		if (goal[i] >= 0) {
+			plannedUnits.push_back(i);
+			planStarts.push_back(position[i]);
+			planGoals.push_back(goal[i]);
+		}
+	}
+	if (plannedUnits.empty())
+		return;
+	planner->plan(planStarts, planGoals, plannedPaths);
+	for (size_t p = 0; p < plannedUnits.size(); ++p) {
+		int unit = plannedUnits[p];
+		patrol[unit] = false;
+		setPath(unit, plannedPaths[p].data(), plannedPaths[p].size());
+	}
+}
+
+void UnitSystem::moveRange(int first, int last) {
+	//One tile along the path per tick
+	const tiletype* tiles = mapref->tiles.data();
+	const int* pool = pathPool.data();
+	for (int i = first; i < last; ++i) {
+		previousPosition[i] = position[i];
+		int length = pathLength[i];
+		if (length < 2)
+			continue;
+		int next = pathCursor[i] + pathDirection[i];
+		if (next < 0 || next >= length) {
+			if (!patrol[i])
+				continue;
+			pathDirection[i] = -pathDirection[i];
+			next = pathCursor[i] + pathDirection[i];
+		}
+		int tile = pool[pathStart[i] + next];
+		//A wall that appeared on the path holds the unit until it gets a new path
+		if (tiles[tile] == wall)
+			continue;
+		pathCursor[i] = next;
+		position[i] = tile;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "Map.h"
+#include "ThreadPool.h"
+#include "SpatialHash.h"
+#include "CooperativePlanner.h"
+#include <cstdint>
+
+//Many units kept as parallel arrays instead of one object each, so a tick is a tight loop over plain data.
+//Unit i is element i of every array. Paths are stored back to back in pathPool, and each unit keeps an offset and length into it
+class UnitSystem {
+public:
+	Map* mapref;
+	ThreadPool* workers; //Big updates are split across these, NULL runs everything on the calling thread
+	static const int chunkSize = 4096; //Units per parallel job
+
+	std::vector<int> position;
+	std::vector<int> previousPosition;
+	std::vector<uint8_t> enemyAgent;
+	std::vector<uint8_t> selected;
+	std::vector<uint8_t> patrol; //Walk back along the path after reaching an end of it, instead of stopping
+	std::vector<int> pathStart; //Offset of the unit's path in pathPool
+	std::vector<int> pathLength;
+	std::vector<int> pathCursor; //Index in the path of the tile the unit is on
+	std::vector<int8_t> pathDirection; //1 while walking towards the end of the path, -1 while walking back
+	std::vector<int> pathPool;
+	std::vector<int> goal; //Tile the planner takes the unit to, -1 for units that only walk the path they're given
+	SpatialHash index; //Unit numbers by tile
+	CooperativePlanner* planner = NULL; //Plans the units with a goal together, so they don't collide
+
+	UnitSystem(Map& mref, ThreadPool* pool = NULL);
+	int addUnit(bool isEnemy, int pos, bool patrols = false);
+	int size() const { return position.size(); }
+	void clear();
+	//Give a unit a new path, starting on the path's first tile
+	void setPath(int unit, const int* tiles, int length);
+	void setPath(int unit, const std::list<int>& tiles);
+	void clearPath(int unit);
+
+	//One tick for every unit, using the click fields on the map like Unit does
+	void update();
+
+private:
+	int unusedPathTiles = 0; //Tiles in pathPool that no unit points at anymore
+	std::vector<int> found; //Reused for index queries
+	int ticksUntilPlan = 0;
+	std::vector<int> plannedUnits;
+	std::vector<int> planStarts;
+	std::vector<int> planGoals;
+	std::vector<std::vector<int>> plannedPaths;
+
+	void planTogether();
+	void moveRange(int first, int last);
+	void compactPaths();
+};
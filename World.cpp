@@ -0,0 +1,227 @@
+#include "stdafx.h"
+#include "World.h"
+#include <queue>
+#include <algorithm>
+#include <climits>
+
+World::World(int seed, int tilesPerChunk, int chunkBudget, genParams parameters) {
+	worldSeed = seed;
+	params = parameters;
+	//Smaller chunks have no space for a room, and the generator's placement divides by zero
+	chunkSize = std::max(tilesPerChunk, MapGenerator::smallestSide(params));
+	//One chunk pinned and one free for the next load
+	maxLoadedChunks = std::max(chunkBudget, 2);
+}
+
+std::uint64_t World::chunkKey(sf::Vector2i coord) {
+	return (std::uint64_t(std::uint32_t(coord.x)) << 32) | std::uint32_t(coord.y);
+}
+
+std::uint64_t World::hashCoord(sf::Vector2i coord, int salt) const {
+	//Mix the world seed, coordinate and salt so neighbouring chunks get unrelated values (splitmix64 finaliser)
+	std::uint64_t h = chunkKey(coord) ^ (std::uint64_t(std::uint32_t(worldSeed)) * 0x9E3779B97F4A7C15ull) ^ (std::uint64_t(salt) << 1);
+	h ^= h >> 30;
+	h *= 0xBF58476D1CE4E5B9ull;
+	h ^= h >> 27;
+	h *= 0x94D049BB133111EBull;
+	h ^= h >> 31;
+	return h;
+}
+
+sf::Vector2i World::chunkOf(sf::Vector2i tile) const {
+	//Round towards negative infinity so negative tiles land in negative chunks
+	sf::Vector2i coord;
+	coord.x = tile.x >= 0 ? tile.x / chunkSize : (tile.x + 1) / chunkSize - 1;
+	coord.y = tile.y >= 0 ? tile.y / chunkSize : (tile.y + 1) / chunkSize - 1;
+	return coord;
+}
+
+tiletype World::getTile(sf::Vector2i tile) {
+	sf::Vector2i coord = chunkOf(tile);
+	worldChunk* chunk = lastChunk;
+	if (chunk == NULL || chunk->coord != coord) {
+		chunk = &loadChunk(coord);
+	}
+	chunk->lastUsed = useCounter;
+	sf::Vector2i local = tile - coord * chunkSize;
+	return chunk->tiles[local.x + local.y * chunkSize];
+}
+
+worldChunk& World::loadChunk(sf::Vector2i coord) {
+	++useCounter;
+	std::unordered_map<std::uint64_t, worldChunk>::iterator it = chunks.find(chunkKey(coord));
+	if (it == chunks.end()) {
+		//Make room first so memory never goes past the budget
+		if (int(chunks.size()) >= maxLoadedChunks) {
+			evictChunks();
+		}
+		worldChunk& chunk = chunks[chunkKey(coord)];
+		chunk.coord = coord;
+		generateChunk(chunk);
+		it = chunks.find(chunkKey(coord));
+	}
+	it->second.lastUsed = useCounter;
+	lastChunk = &it->second;
+	return it->second;
+}
+
+void World::generateChunk(worldChunk& chunk) {
+	//Build the chunk like a normal map, then open its borders where the neighbours expect a door
+	mapLayout layout = MapGenerator::generate(int(hashCoord(chunk.coord, 0)), chunkSize, chunkSize, params);
+	chunk.tiles.swap(layout.tiles);
+	chunk.rooms.swap(layout.rooms);
+	//Each edge is shared by two chunks, so the door position is hashed from the edge, not the chunk
+	//The east and south edges of a chunk are the west and north edges of its neighbours
+	const int low = 2;
+	const int span = chunkSize - 4;
+	if (span <= 0)
+		return;
+	int eastDoor = low + hashCoord(chunk.coord, 1) % span;
+	int westDoor = low + hashCoord(chunk.coord - sf::Vector2i(1, 0), 1) % span;
+	int southDoor = low + hashCoord(chunk.coord, 2) % span;
+	int northDoor = low + hashCoord(chunk.coord - sf::Vector2i(0, 1), 2) % span;
+	carveSeam(chunk, sf::Vector2i(chunkSize - 1, eastDoor), sf::Vector2i(-1, 0));
+	carveSeam(chunk, sf::Vector2i(0, westDoor), sf::Vector2i(1, 0));
+	carveSeam(chunk, sf::Vector2i(southDoor, chunkSize - 1), sf::Vector2i(0, -1));
+	carveSeam(chunk, sf::Vector2i(northDoor, 0), sf::Vector2i(0, 1));
+}
+
+void World::carveSeam(worldChunk& chunk, sf::Vector2i edgeTile, sf::Vector2i inward) {
+	//Carve a hall from the border door towards the nearest room centre, stopping at the first ground tile
+	if (chunk.rooms.empty()) {
+		//No rooms to reach, so carve straight through to the opposite edge
+		sf::Vector2i pos = edgeTile;
+		for (int i = 0; i < chunkSize; ++i, pos += inward)
+			chunk.tiles[pos.x + pos.y * chunkSize] = ground;
+		return;
+	}
+	sf::Vector2i target;
+	int bestDist = INT_MAX;
+	for (const room& r : chunk.rooms) {
+		sf::Vector2i center = r.position + r.size / 2;
+		int dist = std::abs(center.x - edgeTile.x) + std::abs(center.y - edgeTile.y);
+		if (dist < bestDist) {
+			bestDist = dist;
+			target = center;
+		}
+	}
+	sf::Vector2i pos = edgeTile;
+	chunk.tiles[pos.x + pos.y * chunkSize] = ground;
+	//Leave the border, then walk along the axis into the chunk, then across to the room
+	sf::Vector2i along = inward.x != 0 ? sf::Vector2i(0, target.y > pos.y ? 1 : -1) : sf::Vector2i(target.x > pos.x ? 1 : -1, 0);
+	pos += inward;
+	while (pos != target) {
+		int tile = pos.x + pos.y * chunkSize;
+		if (chunk.tiles[tile] == ground)
+			return;
+		chunk.tiles[tile] = ground;
+		bool depthReached = inward.x != 0 ? pos.x == target.x : pos.y == target.y;
+		pos += depthReached ? along : inward;
+	}
+}
+
+void World::evictChunks() {
+	//Drop least recently used chunks until there's room for one more, never dropping pinned ones.
+	//Fewer chunks than the budget are pinned, so there's always one to drop
+	while (int(chunks.size()) >= maxLoadedChunks) {
+		std::unordered_map<std::uint64_t, worldChunk>::iterator oldest = chunks.end();
+		for (std::unordered_map<std::uint64_t, worldChunk>::iterator it = chunks.begin(); it != chunks.end(); ++it) {
+			if (std::find(pinnedChunks.begin(), pinnedChunks.end(), it->first) != pinnedChunks.end())
+				continue;
+			if (oldest == chunks.end() || it->second.lastUsed < oldest->second.lastUsed)
+				oldest = it;
+		}
+		if (oldest == chunks.end())
+			return;
+		if (lastChunk == &oldest->second)
+			lastChunk = NULL;
+		chunks.erase(oldest);
+	}
+}
+
+void World::update(const std::vector<sf::Vector2i>& focusTiles, int radius) {
+	//Chunks around the focus tiles can't be evicted until the next update. Rings further out are only pinned while
+	//they fit in the budget, less one slot for loading, so every focus tile keeps its own chunk before others get more
+	pinnedChunks.clear();
+	int pinLimit = maxLoadedChunks - 1;
+	for (int ring = 0; ring <= radius && int(pinnedChunks.size()) < pinLimit; ++ring) {
+		for (size_t i = 0; i < focusTiles.size() && int(pinnedChunks.size()) < pinLimit; ++i) {
+			sf::Vector2i center = chunkOf(focusTiles[i]);
+			for (int y = -ring; y <= ring && int(pinnedChunks.size()) < pinLimit; ++y) {
+				for (int x = -ring; x <= ring && int(pinnedChunks.size()) < pinLimit; ++x) {
+					sf::Vector2i coord = center + sf::Vector2i(x, y);
+					if (std::max(std::abs(x), std::abs(y)) != ring
+						|| std::find(pinnedChunks.begin(), pinnedChunks.end(), chunkKey(coord)) != pinnedChunks.end())
+						continue;
+					pinnedChunks.push_back(chunkKey(coord));
+					loadChunk(coord);
+				}
+			}
+		}
+	}
+	//Keep one free slot so the next load doesn't have to evict
+	evictChunks();
+}
+
+std::list<sf::Vector2i> World::astar(sf::Vector2i start, sf::Vector2i end, int maxExpansions) {
+	//Same moves and costs as Map::astar, but nodes are keyed by world tile so the search isn't limited to one grid
+	typedef std::pair<float, std::uint64_t> openNode;
+	struct nodeInfo {
+		float cost;
+		std::uint64_t prior;
+		bool closed;
+	};
+	const sf::Vector2i neighborNodes[8] = {
+		sf::Vector2i(-1,-1), sf::Vector2i(0,-1), sf::Vector2i(1,-1), sf::Vector2i(-1,0),
+		sf::Vector2i(1,0), sf::Vector2i(-1,1), sf::Vector2i(0,1), sf::Vector2i(1,1)
+	};
+	auto heuristic = [&end](sf::Vector2i pos) {
+		return std::sqrt(float((pos.x - end.x) * (pos.x - end.x) + (pos.y - end.y) * (pos.y - end.y)));
+	};
+	auto fromKey = [](std::uint64_t key) {
+		return sf::Vector2i(int(std::int32_t(key >> 32)), int(std::int32_t(key & 0xFFFFFFFFu)));
+	};
+	std::unordered_map<std::uint64_t, nodeInfo> nodes;
+	std::priority_queue<openNode, std::vector<openNode>, std::greater<openNode>> openSet;
+	std::uint64_t startKey = chunkKey(start);
+	std::uint64_t endKey = chunkKey(end);
+	nodes[startKey] = { 0.f, startKey, false };
+	openSet.push(openNode(heuristic(start), startKey));
+	int expansions = 0;
+	//Past this many nodes the search would know more tiles than fit in the loaded chunks
+	size_t maxNodes = size_t(maxLoadedChunks) * chunkSize * chunkSize;
+	while (!openSet.empty() && expansions < maxExpansions && nodes.size() < maxNodes) {
+		std::uint64_t currentKey = openSet.top().second;
+		openSet.pop();
+		nodeInfo& current = nodes[currentKey];
+		if (current.closed)
+			continue;
+		current.closed = true;
+		++expansions;
+		if (currentKey == endKey) {
+			std::list<sf::Vector2i> fullPath = { end };
+			while (currentKey != startKey) {
+				currentKey = nodes[currentKey].prior;
+				fullPath.push_front(fromKey(currentKey));
+			}
+			return fullPath;
+		}
+		sf::Vector2i currentPos = fromKey(currentKey);
+		float currentCost = current.cost;
+		for (sf::Vector2i offset : neighborNodes) {
+			sf::Vector2i neighborPos = currentPos + offset;
+			if (getTile(neighborPos) != ground)
+				continue;
+			std::uint64_t neighborKey = chunkKey(neighborPos);
+			float tempCost = currentCost + (offset.x != 0 && offset.y != 0 ? 1.41421356f : 1.f);
+			std::unordered_map<std::uint64_t, nodeInfo>::iterator found = nodes.find(neighborKey);
+			if (found != nodes.end() && (found->second.closed || tempCost >= found->second.cost))
+				continue;
+			nodes[neighborKey] = { tempCost, currentKey, false };
+			openSet.push(openNode(tempCost + heuristic(neighborPos), neighborKey));
+		}
+	}
+	//Ran out of nodes or budget, so stay put like Map::astar does
+	std::list<sf::Vector2i> errorList = { start };
+	return errorList;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "MapGenerator.h"
+#include <unordered_map>
+#include <cstdint>
+
+//One fixed size piece of the world, generated from the world seed and its coordinate
+struct worldChunk {
+	sf::Vector2i coord;
+	std::vector<tiletype> tiles;
+	std::vector<room> rooms;
+	std::uint64_t lastUsed = 0;
+};
+
+//An unbounded world made of chunks that are generated when first needed and evicted when unused
+//Tile positions are in world tiles, chunk (cx, cy) covers tiles [cx * chunkSize, cx * chunkSize + chunkSize)
+class World {
+public:
+	//Chunks are at least MapGenerator::smallestSide tiles across, and at least 2 are kept loaded
+	World(int seed, int tilesPerChunk = 32, int chunkBudget = 64, genParams parameters = genParams());
+
+	tiletype getTile(sf::Vector2i tile);
+	sf::Vector2i chunkOf(sf::Vector2i tile) const;
+	int loadedChunks() const { return chunks.size(); }
+	int tilesPerChunk() const { return chunkSize; }
+	int chunkBudget() const { return maxLoadedChunks; }
+
+	//Load the chunks within radius of every focus tile (unit positions) and evict the least recently used others.
+	//Fewer than chunkBudget chunks are kept loaded this way, nearest to the focus tiles first, so the budget always holds
+	void update(const std::vector<sf::Vector2i>& focusTiles, int radius = 1);
+	//A* in world tiles. Chunks are loaded as the search reaches them, and the search gives up after maxExpansions or once
+	//it knows as many tiles as the chunk budget holds
+	std::list<sf::Vector2i> astar(sf::Vector2i start, sf::Vector2i end, int maxExpansions = 200000);
+
+private:
+	int worldSeed;
+	int chunkSize;
+	int maxLoadedChunks;
+	genParams params;
+	std::unordered_map<std::uint64_t, worldChunk> chunks;
+	std::uint64_t useCounter = 0;
+	worldChunk* lastChunk = NULL; //Most searches stay in one chunk for many lookups
+	std::vector<std::uint64_t> pinnedChunks; //Chunks around the focus tiles of the last update
+
+	static std::uint64_t chunkKey(sf::Vector2i coord);
+	std::uint64_t hashCoord(sf::Vector2i coord, int salt) const;
+	worldChunk& loadChunk(sf::Vector2i coord);
+	void generateChunk(worldChunk& chunk);
+	void carveSeam(worldChunk& chunk, sf::Vector2i edgeTile, sf::Vector2i inward);
+	void evictChunks();
+};
@@ -2,34 +2,57 @@
 #include <SFML/Graphics.hpp> //SFML 2.5.1
 #include "Map.h"
 #include "Unit.h"
+#include "SpriteBatch.h"
+#include "Simulation.h"
+#include "Headless.h"
 #include <iostream>
 
-const sf::Time frameTime = sf::seconds(1.f / 20.f);
+const sf::Time frameTime = sf::seconds(1.f / 20.f); //Length of one simulation tick
+const bool threadedSimulation = false; //Run ticks on their own thread instead of between frames
+const float panSpeed = 600.f; //Screen pixels per second when panning with the arrow keys
+const float zoomStep = 1.25f;
 
-int main()
+int main(int argc, char* argv[])
 {
+	//--headless [script] runs the simulation from a script without opening a window
+	if (argc > 1 && std::string(argv[1]) == "--headless") {
+		return runHeadless(argc > 2 ? argv[2] : "");
+	}
+
 	sf::RenderWindow window(sf::VideoMode(800, 800), "Algorithms");
 	Map GameMap(window, 25, 25);
-	Unit player(GameMap, false, 164);
-	Unit enemy(GameMap, true, 27);
+	Simulation sim(GameMap, frameTime);
+	Unit& player = sim.addUnit(false, 164);
+	Unit& enemy = sim.addUnit(true, 27);
+	sim.pathSeeker = &enemy;
+	sim.pathTarget = &player;
+
+	const float aStarDotRadius = 5.f;
+	const float crowdRadius = GameMap.tileW / 4.f;
+	const sf::Vector2f tileCenter(GameMap.tileW / 2.f, GameMap.tileH / 2.f);
 
-	bool testAStar = true;
-	std::list<int> aStarPath;
-	sf::CircleShape aStarDot;
-	aStarDot.setRadius(5.f);
-	aStarDot.setFillColor(sf::Color::Green);
-	aStarDot.setOrigin({ 5.f - (GameMap.tileW / 2.f),5.f - (GameMap.tileH / 2.f) });
+	//Units and path dots are collected here and drawn together once per frame
+	SpriteBatch batch;
 
-	bool rebuildMap = false;
+	//The camera shows part of the map when it's bigger than the window
+	sf::View camera = window.getDefaultView();
+	bool dragCamera = false;
+	sf::Vector2i dragPixel;
+
+	//Left button state stays here, the simulation only sees it through simInput
+	bool clickDown = false;
 
 	sf::Clock dtClock;
 
+	if (threadedSimulation) {
+		sim.startThread();
+	}
+
 	while (window.isOpen())
 	{
 		//Reset game loop values
 		window.clear();
-		GameMap.newClick = false;
-		GameMap.endClick = false;
+		simInput input;
 
 		sf::Event event;
 		while (window.pollEvent(event))
@@ -41,51 +64,106 @@ int main()
 					window.close();
 				if (event.key.code == sf::Keyboard::P) {
 					//Test a new path by pressing P
-					testAStar = true;
+					input.testPath = true;
 				}
 				if (event.key.code == sf::Keyboard::M) {
 					//Rebuild map by pressing M
-					rebuildMap = true;
+					input.rebuildMap = true;
 				}
 			}
 
 			if (event.type == sf::Event::MouseButtonPressed) {
 				if (event.key.code == sf::Mouse::Left) {
 					//Register a new mouse click for moving units
-					GameMap.clickDown = true;
-					GameMap.newClick = true;
+					clickDown = true;
+					input.newClick = true;
 				}
 			}
 			if (event.type == sf::Event::MouseButtonReleased) {
 				if (event.key.code == sf::Mouse::Left) {
 					//Reset to unclicked
-					GameMap.clickDown = false;
-					GameMap.endClick = true;
+					clickDown = false;
+					input.endClick = true;
 				}
 			}
-			if (event.type == sf::Event::MouseMoved) {
-				GameMap.mousePos = GameMap.getTileN(sf::Mouse::getPosition(window).x, sf::Mouse::getPosition(window).y);
+			if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Right) {
+				//Drag the camera with the right mouse button
+				dragCamera = true;
+				dragPixel = sf::Vector2i(event.mouseButton.x, event.mouseButton.y);
+			}
+			if (event.type == sf::Event::MouseButtonReleased && event.mouseButton.button == sf::Mouse::Right) {
+				dragCamera = false;
+			}
+			if (event.type == sf::Event::MouseMoved && dragCamera) {
+				sf::Vector2i pixel(event.mouseMove.x, event.mouseMove.y);
+				camera.move(window.mapPixelToCoords(dragPixel, camera) - window.mapPixelToCoords(pixel, camera));
+				dragPixel = pixel;
+			}
+			if (event.type == sf::Event::MouseWheelScrolled) {
+				//Zoom around the cursor, so the tile under it stays put
+				sf::Vector2i pixel(event.mouseWheelScroll.x, event.mouseWheelScroll.y);
+				sf::Vector2f before = window.mapPixelToCoords(pixel, camera);
+				camera.zoom(event.mouseWheelScroll.delta > 0 ? 1.f / zoomStep : zoomStep);
+				camera.move(before - window.mapPixelToCoords(pixel, camera));
 			}
 		}
-		GameMap.drawMap(window);
-		player.update(window);
-		enemy.update(window);
-		if (testAStar) {
-			aStarPath = GameMap.astar(enemy.position, player.position);
-			testAStar = false;
-		}
-		for (int tile : aStarPath) {
-			aStarDot.setPosition(GameMap.getTilePos(tile));
-			window.draw(aStarDot);
+		//Pan with the arrow keys, at the same screen speed at any zoom
+		sf::Time dt = dtClock.restart();
+		sf::Vector2f pan;
+		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left))
+			pan.x -= 1.f;
+		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right))
+			pan.x += 1.f;
+		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up))
+			pan.y -= 1.f;
+		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down))
+			pan.y += 1.f;
+		camera.move(pan * panSpeed * dt.asSeconds() * camera.getSize().x / float(window.getSize().x));
+		window.setView(camera);
+		//The tile under the mouse changes when either the mouse or the camera moves
+		sf::Vector2f mouseWorld = window.mapPixelToCoords(sf::Mouse::getPosition(window));
+		int mousePos = GameMap.getTileN(mouseWorld.x, mouseWorld.y);
+		input.clickDown = clickDown;
+		input.mousePos = mousePos;
+
+		//Hand input to the simulation, and run the ticks that are due when it shares this thread
+		sim.queueInput(input);
+		if (!threadedSimulation) {
+			sim.advance(dt);
 		}
+		simSnapshot snapshot = sim.getSnapshot();
+		float alpha = sim.interpolation(snapshot);
 
-		if (rebuildMap) {
-			GameMap.generateMap(1);
-			rebuildMap = false;
+		batch.clear();
+		{
+			//The simulation thread swaps tiles under this lock
+			std::lock_guard<std::mutex> guard(sim.mapLock);
+			GameMap.drawMap(window);
+			//Preview where the selected unit would be dropped
+			for (const unitSnapshot& u : snapshot.units) {
+				if (u.selected && clickDown && mousePos >= 0 && GameMap.tiles[mousePos] != wall) {
+					sf::Color previewColor = u.enemyAgent ? sf::Color(255, 0, 0, 127) : sf::Color(0, 0, 255, 127);
+					batch.addCircle(GameMap.getTilePos(mousePos) + tileCenter, GameMap.previewUnitDrop.getRadius(), previewColor);
+				}
+			}
+		}
+		//Draw units between their last two tick positions
+		for (const unitSnapshot& u : snapshot.units) {
+			batch.addCircle(u.previousPixel + (u.pixel - u.previousPixel) * alpha + sf::Vector2f(u.radius, u.radius), u.radius, u.color);
+		}
+		for (size_t i = 0; i < snapshot.crowdPosition.size(); ++i) {
+			sf::Vector2f from = GameMap.getTilePos(snapshot.crowdPrevious[i]);
+			sf::Vector2f to = GameMap.getTilePos(snapshot.crowdPosition[i]);
+			batch.addCircle(from + (to - from) * alpha + tileCenter, crowdRadius, snapshot.crowdEnemy[i] ? sf::Color::Red : sf::Color::Blue);
+		}
+		for (int tile : snapshot.path) {
+			batch.addCircle(GameMap.getTilePos(tile) + tileCenter, aStarDotRadius, sf::Color::Green);
 		}
+		batch.draw(window);
 
 		window.display();
 	}
 
+	sim.stopThread();
 	return 0;
 }